@@ -0,0 +1,200 @@
+#include "cfg.h"
+#include "common.h"
+#include "dom.h"
+#include "ir.h"
+#include "map.h"
+#include <stdlib.h>
+
+/**
+ * Aggressive dead code elimination. Everything with an effect is live,
+ * then so are the definitions of whatever a live instruction uses and the
+ * branches a block holding one is control dependent on. Pure instructions
+ * left over go, and a branch left over jumps to the nearest post-dominator
+ * with something live in it, which drops loops nothing observes.
+ */
+
+typedef struct dep_t dep_t;
+struct dep_t {
+    block_t *on;
+    dep_t   *next;
+};
+
+static block_t **ipdom;
+static dep_t   **deps;
+static bool     *useful;
+static set_t     live, vars;
+static IR_t    **work, **defs;
+static u32       nwork, ndef;
+
+static bool is_root(const IR_t *ir) {
+    switch (ir->kind) {
+        IR_PURE(CASE)
+        case IR_LABEL:
+        case IR_GOTO: return false;
+        // as in C, only a loop on a constant condition may be meant to never end
+        case IR_BRANCH: return ir->lhs.kind == OPRD_LIT && ir->rhs.kind == OPRD_LIT;
+        default: return true;
+    }
+}
+
+static i32 def_cmp(const void *lhs, const void *rhs) {
+    uptr l = (*(IR_t *const *) lhs)->tar.id, r = (*(IR_t *const *) rhs)->tar.id;
+    return l < r ? -1 : l > r;
+}
+
+static void mark(IR_t *ir) {
+    if (!set_contains(&live, ir)) {
+        set_insert(&live, ir);
+        work[nwork++] = ir;
+    }
+}
+
+static void use(oprd_t oprd) {
+    if (oprd.kind != OPRD_VAR || set_contains(&vars, (void *) oprd.id)) {
+        return;
+    }
+    set_insert(&vars, (void *) oprd.id);
+    // the first definition of `oprd` in `defs`, sorted by target
+    u32 lo = 0, hi = ndef;
+    while (lo < hi) {
+        u32 mid = (lo + hi) / 2;
+        if (defs[mid]->tar.id < oprd.id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    for (; lo < ndef && defs[lo]->tar.id == oprd.id; lo++) {
+        mark(defs[lo]);
+    }
+}
+
+static void propagate() {
+    while (nwork > 0) {
+        IR_t    *ir  = work[--nwork];
+        block_t *blk = ir->parent;
+        if (!useful[blk->id]) {
+            useful[blk->id] = true;
+            LIST_ITER(deps[blk->id], it) {
+                mark(it->on->instrs.tail);
+            }
+        }
+        use(ir->lhs);
+        use(ir->rhs);
+        if (ir->kind == IR_STORE) {
+            use(ir->tar);
+        }
+    }
+}
+
+// the blocks up the post-dominator tree from a successor of `from`, short
+// of its own post-dominator, depend on the branch of `from`; false if a
+// successor never gets to the exit
+static bool depends(block_t *from) {
+    succ_iter(from, e) {
+        if (ipdom[e->to->id] == NULL) {
+            return false;
+        }
+    }
+    succ_iter(from, e) {
+        for (block_t *it = e->to; it != ipdom[from->id]; it = ipdom[it->id]) {
+            dep_t *dep   = zalloc(sizeof(dep_t));
+            *dep         = (dep_t){.on = from, .next = deps[it->id]};
+            deps[it->id] = dep;
+        }
+    }
+    return true;
+}
+
+// the nearest block on every way from `blk` to the exit that does
+// something, NULL if there is none
+static block_t *useful_pdom(cfg_t *cfg, block_t *blk) {
+    block_t *it = ipdom[blk->id];
+    while (it != cfg->exit && !useful[it->id]) {
+        it = ipdom[it->id];
+    }
+    return it == cfg->exit ? NULL : it;
+}
+
+void do_adce(cfg_t *cfg) {
+    u32 ninstr = 0;
+    LIST_ITER(cfg->blocks, blk) {
+        ninstr += blk->instrs.size;
+    }
+    ipdom  = pdom_tree(cfg);
+    deps   = zalloc(sizeof(dep_t *) * cfg->nnode);
+    useful = zalloc(sizeof(bool) * cfg->nnode);
+    work   = zalloc(sizeof(IR_t *) * (ninstr + 1));
+    defs   = zalloc(sizeof(IR_t *) * (ninstr + 1));
+    nwork = ndef = 0;
+    set_init(&live);
+    set_init(&vars);
+    LIST_ITER(cfg->blocks, blk) {
+        LIST_ITER(blk->instrs.head, ir) {
+            if (ir->kind != IR_STORE && ir->tar.kind == OPRD_VAR) {
+                defs[ndef++] = ir;
+            }
+        }
+    }
+    qsort(defs, ndef, sizeof(IR_t *), def_cmp);
+
+    // post-dominance says nothing about blocks that never get to the exit,
+    // so branches there and into there stay
+    LIST_ITER(cfg->blocks, blk) {
+        IR_t *br = blk->instrs.tail;
+        if (br != NULL && br->kind == IR_BRANCH && (ipdom[blk->id] == NULL || !depends(blk))) {
+            mark(br);
+        }
+        LIST_ITER(blk->instrs.head, ir) {
+            if (is_root(ir)) {
+                mark(ir);
+            }
+        }
+    }
+    propagate();
+
+    // a branch with nothing live after it to jump to stays too
+    LIST_ITER(cfg->blocks, blk) {
+        IR_t *br = blk->instrs.tail;
+        if (br != NULL && br->kind == IR_BRANCH && !set_contains(&live, br) && useful_pdom(cfg, blk) == NULL) {
+            mark(br);
+            propagate();
+        }
+    }
+
+    LIST_ITER(cfg->blocks, blk) {
+        IR_t *br = blk->instrs.tail;
+        if (br != NULL && br->kind == IR_BRANCH && !set_contains(&live, br)) {
+            block_t *to = useful_pdom(cfg, blk);
+            br->kind    = IR_GOTO;
+            br->jmpto   = block_label(to);
+            br->lhs = br->rhs = (oprd_t){0};
+            succ_iter(blk, e) {
+                e->mark = true;
+            }
+            edge_insert(cfg, blk, to, EDGE_GOTO);
+        }
+        LIST_ITER(blk->instrs.head, ir) {
+            switch (ir->kind) {
+                IR_PURE(CASE) ir->mark = !set_contains(&live, ir); break;
+                default: break;
+            }
+        }
+        ir_remove_mark(&blk->instrs);
+    }
+    edge_remove_mark(cfg);
+
+#define FORALL(NODE) (true)
+    LIST_ITER(cfg->blocks, blk) {
+        LIST_REMOVE(deps[blk->id], zfree, FORALL);
+    }
+#undef FORALL
+    set_fini(&live);
+    set_fini(&vars);
+    zfree(ipdom);
+    zfree(deps);
+    zfree(useful);
+    zfree(work);
+    zfree(defs);
+    cfg_remove_unreachable(cfg);
+}
@@ -0,0 +1,175 @@
+#include "alias.h"
+#include "common.h"
+
+/**
+ * Points-to analysis within a function, blind to the order of instructions.
+ * A variable points where every definition of it does: `IR_DREF` takes the
+ * address of an object, `IR_PARAM` gets one from the caller, adding a
+ * literal moves it, as `lexpr.c` does for a field, and adding a variable,
+ * as it does for an index, forgets by how much. Nothing else makes an
+ * address. An object whose address is passed to a callee, stored or
+ * returned escapes.
+ */
+
+static const loc_t LOC_ANY = {0};
+
+static bool loc_find(const alias_t *pa, oprd_t oprd, loc_t *loc) {
+    loc_t *found = oprd.kind == OPRD_VAR ? map_find(&pa->locs, (void *) oprd.id) : NULL;
+    if (found != NULL) {
+        *loc = *found;
+    }
+    return found != NULL;
+}
+
+static bool loc_eq(loc_t lhs, loc_t rhs) {
+    return lhs.base == rhs.base && lhs.ext == rhs.ext && lhs.exact == rhs.exact && (!lhs.exact || lhs.off == rhs.off);
+}
+
+// certainly an address, unlike what a parameter holds
+static bool on_object(loc_t loc) {
+    return loc.base != 0 && !loc.ext;
+}
+
+static loc_t loc_join(loc_t lhs, loc_t rhs) {
+    if (lhs.base == rhs.base && lhs.ext == rhs.ext) {
+        lhs.exact = lhs.exact && rhs.exact && lhs.off == rhs.off;
+        return lhs;
+    }
+    return (loc_t){.ext = lhs.ext && rhs.ext};
+}
+
+// merges `loc` into what `tar` points to, whether that changed
+static bool loc_def(alias_t *pa, oprd_t tar, loc_t loc) {
+    loc_t *old = map_find(&pa->locs, (void *) tar.id);
+    if (old == NULL) {
+        old = zalloc(sizeof(loc_t));
+        map_insert(&pa->locs, (void *) tar.id, old);
+        *old = loc;
+        return true;
+    }
+    loc = loc_join(*old, loc);
+    if (loc_eq(*old, loc)) {
+        return false;
+    }
+    *old = loc;
+    return true;
+}
+
+static bool transfer(alias_t *pa, IR_t *ir) {
+    oprd_t lhs = ir->lhs, rhs = ir->rhs;
+    loc_t  loc, other;
+    switch (ir->kind) {
+        case IR_DREF: return loc_def(pa, ir->tar, (loc_t){.base = lhs.id, .exact = true});
+        case IR_PARAM: return loc_def(pa, ir->tar, (loc_t){.base = ir->tar.id, .ext = true, .exact = true});
+        case IR_ASSIGN: return loc_find(pa, lhs, &loc) && loc_def(pa, ir->tar, loc);
+        case IR_BINARY: {
+            if (ir->op == OP_ADD && lhs.kind == OPRD_LIT) {
+                swap(lhs, rhs);
+            }
+            if ((ir->op == OP_ADD || ir->op == OP_SUB) && rhs.kind == OPRD_LIT) {
+                if (!loc_find(pa, lhs, &loc)) {
+                    return false;
+                }
+                loc.off += ir->op == OP_ADD ? rhs.val : -rhs.val;
+                return loc_def(pa, ir->tar, loc);
+            }
+            if (ir->op != OP_ADD && ir->op != OP_SUB) {
+                return false;
+            }
+            bool has_lhs = loc_find(pa, lhs, &loc), has_rhs = loc_find(pa, rhs, &other);
+            if (!has_lhs && !has_rhs) {
+                return false;
+            }
+            // of an object and what may be an index, the object is what is
+            // pointed into
+            if (!has_lhs || (has_rhs && !on_object(loc) && on_object(other))) {
+                loc = other;
+            } else if (has_rhs && on_object(loc) == on_object(other)) {
+                loc = loc_join(loc, other);
+            }
+            loc.exact = false;
+            return loc_def(pa, ir->tar, loc);
+        }
+        default: return false;
+    }
+}
+
+void alias_init(alias_t *pa, cfg_t *cfg) {
+    map_init(&pa->locs);
+    set_init(&pa->escaped);
+    pa->any_escaped = false;
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        LIST_ITER(cfg->blocks, blk) {
+            LIST_ITER(blk->instrs.head, ir) {
+                changed |= transfer(pa, ir);
+            }
+        }
+    }
+    LIST_ITER(cfg->blocks, blk) {
+        LIST_ITER(blk->instrs.head, ir) {
+            loc_t loc;
+            switch (ir->kind) {
+                case IR_ARG:
+                case IR_STORE:
+                case IR_RETURN: {
+                    if (!loc_find(pa, ir->lhs, &loc) || loc.ext) {
+                        break;
+                    }
+                    if (loc.base == 0) {
+                        pa->any_escaped = true;
+                    } else {
+                        set_insert(&pa->escaped, (void *) loc.base);
+                    }
+                    break;
+                }
+                default: break;
+            }
+        }
+    }
+}
+
+void alias_fini(alias_t *pa) {
+    map_iter(&pa->locs, it) {
+        zfree(it.val);
+    }
+    map_fini(&pa->locs);
+    set_fini(&pa->escaped);
+}
+
+loc_t alias_loc(const alias_t *pa, oprd_t addr) {
+    loc_t loc;
+    return loc_find(pa, addr, &loc) ? loc : LOC_ANY;
+}
+
+alias_kind_t alias_query(loc_t lhs, loc_t rhs) {
+    if ((lhs.base == 0 && !lhs.ext) || (rhs.base == 0 && !rhs.ext)) {
+        return ALIAS_MAY;
+    }
+    // what the caller passed was there before any object of this call
+    if (lhs.ext != rhs.ext) {
+        return ALIAS_NO;
+    }
+    if (lhs.base != rhs.base) {
+        return lhs.ext ? ALIAS_MAY : ALIAS_NO;
+    }
+    if (lhs.base == 0 || !lhs.exact || !rhs.exact) {
+        return ALIAS_MAY;
+    }
+    return lhs.off == rhs.off ? ALIAS_MUST : ALIAS_NO;
+}
+
+static oprd_t addr_of(const IR_t *ir) {
+    ASSERT(ir->kind == IR_LOAD || ir->kind == IR_STORE, "not a memory access");
+    return ir->kind == IR_LOAD ? ir->lhs : ir->tar;
+}
+
+alias_kind_t alias_mem(const alias_t *pa, const IR_t *lhs, const IR_t *rhs) {
+    return alias_query(alias_loc(pa, addr_of(lhs)), alias_loc(pa, addr_of(rhs)));
+}
+
+bool alias_escapes(const alias_t *pa, loc_t loc) {
+    return loc.ext || loc.base == 0 || pa->any_escaped || set_contains(&pa->escaped, (void *) loc.base);
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "cfg.h"
+#include "map.h"
+
+typedef struct alias_t alias_t;
+typedef struct loc_t   loc_t;
+
+typedef enum {
+    ALIAS_NO,
+    ALIAS_MAY,
+    ALIAS_MUST,
+} alias_kind_t;
+
+// where an address points: `off` into the `IR_DEC` object `base`, or into
+// what the parameter `base` was passed when `ext`; any memory at all for
+// base 0, any passed in with `ext` as well, and some offset if not `exact`
+struct loc_t {
+    uptr base;
+    i64  off;
+    bool ext, exact;
+};
+
+// what every variable of a function may point to, whichever definition of
+// it reached there
+struct alias_t {
+    map_t locs;
+    set_t escaped;
+    bool  any_escaped;
+};
+
+void alias_init(alias_t *pa, cfg_t *cfg);
+
+void alias_fini(alias_t *pa);
+
+// where a load or a store through `addr` goes
+loc_t alias_loc(const alias_t *pa, oprd_t addr);
+
+alias_kind_t alias_query(loc_t lhs, loc_t rhs);
+
+// between the addresses two loads or stores go through
+alias_kind_t alias_mem(const alias_t *pa, const IR_t *lhs, const IR_t *rhs);
+
+// whether a callee may read or write at `loc`
+bool alias_escapes(const alias_t *pa, loc_t loc);
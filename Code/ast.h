@@ -65,10 +65,10 @@ extern const char *AST_NAMES[];
 
 struct AST_t {
     EXTENDS(shared);
-    AST_t     *next;
-    u32        fst_l;
-    ast_kind_t kind;
-    type_t     type;
+    AST_t        *next;
+    u32           fst_l;
+    ast_kind_t    kind;
+    const type_t *type;
 };
 
 #define AST_EXTEND(NODE) typedef struct NODE##_t NODE##_t;
@@ -144,10 +144,10 @@ struct EXPR_ARR_t {
 
 struct EXPR_DOT_t {
     EXTENDS(AST_t);
-    char     str[MAX_SYM_LEN];
-    AST_t   *base;
-    field_t *field;
-    type_t   typ;
+    char          str[MAX_SYM_LEN];
+    AST_t        *base;
+    field_t      *field;
+    const type_t *typ;
 };
 
 struct EXPR_INT_t {
@@ -218,6 +218,6 @@ AST_t *ast_alloc(ast_kind_t kind, u32 fst_l, ...);
 
 void ast_free(AST_t *node);
 
-type_t ast_check(AST_t *node);
+const type_t *ast_check(AST_t *node);
 
 bool ast_lval(AST_t *node);
@@ -0,0 +1,68 @@
+#define _DEFAULT_SOURCE
+#include "bench.h"
+#include <string.h>
+#include <time.h>
+
+#define MAX_BENCH 64
+
+typedef struct bench_t {
+    const char *name;
+    u64         ns;
+    u32         calls;
+} bench_t;
+
+static bench_t rows[MAX_BENCH];
+static u32     nrow;
+
+// open BENCHes: start time and time spent in nested ones
+static u64 start[MAX_BENCH], nested[MAX_BENCH];
+static u32 depth;
+
+u64 bench_clock() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64) ts.tv_sec * 1000000000ull + (u64) ts.tv_nsec;
+}
+
+static void bench_add(const char *name, u64 ns) {
+    for (u32 i = 0; i < nrow; i++) {
+        if (!strcmp(rows[i].name, name)) {
+            rows[i].ns += ns;
+            rows[i].calls++;
+            return;
+        }
+    }
+    ASSERT(nrow < MAX_BENCH, "too many bench rows");
+    rows[nrow++] = (bench_t){.name = name, .ns = ns, .calls = 1};
+}
+
+void bench_enter() {
+    ASSERT(depth < MAX_BENCH, "BENCH nested too deep");
+    start[depth]  = bench_clock();
+    nested[depth] = 0;
+    depth++;
+}
+
+void bench_leave(const char *name) {
+    depth--;
+    u64 elapsed = bench_clock() - start[depth];
+    if (depth > 0) {
+        nested[depth - 1] += elapsed;
+    }
+    bench_add(name, elapsed - nested[depth]);
+}
+
+// tab separated, so runs of different revisions can be diffed or joined
+void bench_report(FILE *file) {
+    u64 total = 0;
+    for (u32 i = 0; i < nrow; i++) {
+        total += rows[i].ns;
+    }
+    fprintf(file, "phase\tcalls\tms\tshare\n");
+    for (u32 i = 0; i < nrow; i++) {
+        fprintf(file, "%s\t%u\t%.3f\t%.1f%%\n",
+                rows[i].name, rows[i].calls, rows[i].ns / 1e6,
+                total ? 100.0 * rows[i].ns / total : 0.0);
+    }
+    fprintf(file, "total\t-\t%.3f\t100.0%%\n", total / 1e6);
+}
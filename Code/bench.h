@@ -0,0 +1,27 @@
+#pragma once
+#include "common.h"
+#include "flags.h"
+
+/**
+ * Phase timing for `-bench`. BENCH(NAME, ...) charges the wall time of its
+ * statement to the row NAME, minus the time of BENCHes nested inside it,
+ * so the rows add up to the whole run.
+ */
+#define BENCH(NAME, ...)          \
+    do {                          \
+        if (!flags.bench) {       \
+            __VA_ARGS__;          \
+            break;                \
+        }                         \
+        bench_enter();            \
+        __VA_ARGS__;              \
+        bench_leave((NAME));      \
+    } while (0)
+
+u64 bench_clock();
+
+void bench_enter();
+
+void bench_leave(const char *name);
+
+void bench_report(FILE *file);
@@ -0,0 +1,332 @@
+#define _DEFAULT_SOURCE
+#include "cache.h"
+#include "flags.h"
+#include "profile.h"
+#include "symtab.h"
+#include "visitor.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CACHE_MAGIC "cmm-cache"
+#define MAX_LINE 256
+
+#define RET_TYPE va_list
+#define ARG __none
+VISITOR_DEF(AST, hash, RET_TYPE);
+
+static u64 hash;
+// the line the function being hashed starts at
+static u32 base;
+
+// a hash of the compiler binary itself, so entries of another build of it
+// are never reused; empty if it cannot be read
+static const char *build_stamp() {
+    static char stamp[MAX_LINE];
+    static bool done;
+    if (!done) {
+        done = true;
+        FOPEN("/proc/self/exe", file, "rb") {
+            char   buf[BUFSIZ];
+            size_t len;
+            u64    sum = FNV_INIT;
+            while ((len = fread(buf, 1, sizeof(buf), file)) > 0) {
+                sum = fnv(sum, buf, len);
+            }
+            if (!ferror(file)) {
+                snprintf(stamp, sizeof(stamp), "%s %016lx", CACHE_MAGIC, sum);
+            }
+        }
+    }
+    return stamp;
+}
+
+static void mix(u64 val) {
+    hash = fnv(hash, &val, sizeof(val));
+}
+
+static void mix_str(const char *str) {
+    hash = fnv(hash, str, strlen(str) + 1);
+}
+
+// by layout, which is all the code sees of a type
+static void mix_type(const type_t *typ) {
+    if (typ == NULL) {
+        mix(TYPE_NULL);
+        return;
+    }
+    mix(typ->kind);
+    mix(typ->size);
+    if (typ->kind == TYPE_ARRAY) {
+        mix(typ->dim);
+        for (u32 i = 0; i < typ->dim; i++) {
+            mix(typ->len[i]);
+        }
+        mix_type(typ->elem_typ);
+    }
+    LIST_ITER(typ->fields, it) {
+        mix(it->off);
+        mix_type(it->typ);
+    }
+}
+
+static void mix_ast(AST_t *node) {
+    if (node == NULL) {
+        mix(-1);
+        return;
+    }
+    mix(node->kind);
+    // from the start of the function, so lines added above it change nothing
+    mix(node->fst_l - base);
+    mix_type(node->type);
+    VISITOR_DISPATCH(AST, hash, node, NULL);
+}
+
+static void mix_list(AST_t *list) {
+    mix(LIST_LENGTH(list));
+    LIST_FOREACH(list, mix_ast);
+}
+
+bool cache_enabled() {
+    return flags.cache && !flags.interp && !flags.instrument && !flags.ir_bin && *build_stamp();
+}
+
+u64 cache_key(AST_t *fun) {
+    hash = FNV_INIT;
+    base = fun->fst_l;
+    mix_str(build_stamp());
+    mix(flags.O0);
+    mix(flags.asm_ir);
+    mix(flags.direct);
+    mix(flags.setcc);
+    mix_str(flags.passes ? flags.passes : "");
+    mix_str(flags.loop ? flags.loop : "");
+    INSTANCE_OF(fun, CONS_FUN) {
+        if (profile_loaded()) {
+            hash = profile_digest(cnode->str, hash);
+        }
+    }
+    mix_ast(fun);
+    return hash;
+}
+
+static void entry_path(char *path, u32 size, u64 key) {
+    snprintf(path, size, "%s/%016lx", flags.cache, key);
+}
+
+static char *read_section(FILE *file, const char *name) {
+    char line[MAX_LINE], tag[MAX_LINE];
+    u32  len;
+    if (!fgets(line, sizeof(line), file)
+        || sscanf(line, "@%255s %u", tag, &len) != 2
+        || strcmp(tag, name)) {
+        return NULL;
+    }
+    char *text = malloc(len + 1);
+    if (fread(text, 1, len, file) != len) {
+        free(text);
+        return NULL;
+    }
+    text[len] = '\0';
+    return text;
+}
+
+// temporaries are named after the line they come from: the IR `text` of a
+// function cached when it started at line `from` for one now at `to`
+static char *rebase(char *text, u32 from, u32 to) {
+    if (from == to) {
+        return text;
+    }
+    char  *out, *end;
+    size_t size;
+    FILE  *mem = open_memstream(&out, &size);
+    for (char *cur = text; *cur != '\0';) {
+        bool start = cur == text || !(isalnum(cur[-1]) || cur[-1] == '_');
+        if (start && !strncmp(cur, "t_", 2) && isdigit(cur[2])) {
+            char *at = cur + 2;
+            strtoul(at, &at, 10);
+            if (!strncmp(at, "_at_", 4) && isdigit(at[4])) {
+                u32 line = strtoul(at + 4, &end, 10);
+                if (*end == '_') {
+                    fwrite(cur, 1, at + 4 - cur, mem);
+                    fprintf(mem, "%u", line - from + to);
+                    cur = end;
+                    continue;
+                }
+            }
+        }
+        fputc(*cur++, mem);
+    }
+    fclose(mem);
+    free(text);
+    return out;
+}
+
+static ir_fun_t *read_entry(FILE *file, const char *str, u32 line_at) {
+    char line[MAX_LINE];
+    u32  from;
+    if (!fgets(line, sizeof(line), file) || strcmp(strtok(line, "\n") ?: "", build_stamp())) {
+        return NULL;
+    }
+    ir_fun_t *fun = zalloc(sizeof(ir_fun_t));
+    fun->cached   = true;
+    if (fgets(line, sizeof(line), file)
+        && sscanf(line, "%63s %u %u", fun->str, &fun->sf_size, &from) == 3
+        && !symcmp(fun->str, str)
+        && (fun->ir_text = read_section(file, "ir"))
+        && (fun->asm_text = read_section(file, "s"))) {
+        fun->ir_text = rebase(fun->ir_text, from, line_at);
+        fun->line    = line_at;
+        return fun;
+    }
+    ir_fun_free(fun);
+    return NULL;
+}
+
+ir_fun_t *cache_load(u64 key, const char *str, u32 line) {
+    char      path[BUFSIZ];
+    ir_fun_t *fun = NULL;
+    entry_path(path, sizeof(path), key);
+    FOPEN(path, file, "r") {
+        fun = read_entry(file, str, line);
+    }
+    if (fun) {
+        fun->key = key;
+    }
+    return fun;
+}
+
+void cache_store(ir_fun_t *fun) {
+    char   path[BUFSIZ], tmp[BUFSIZ + 16];
+    char  *ir_text;
+    size_t ir_size;
+    bool   ok = false;
+
+    FILE *mem = open_memstream(&ir_text, &ir_size);
+    ir_fun_print_one(mem, fun);
+    fclose(mem);
+
+    mkdir(flags.cache, 0777);
+    entry_path(path, sizeof(path), fun->key);
+    snprintf(tmp, sizeof(tmp), "%s.%d", path, getpid());
+    FOPEN(tmp, file, "w") {
+        fprintf(file, "%s\n%s %u %u\n", build_stamp(), fun->str, fun->sf_size, fun->line);
+        fprintf(file, "@ir %zu\n%s", ir_size, ir_text);
+        fprintf(file, "@s %zu\n%s", strlen(fun->asm_text), fun->asm_text);
+        ok = !ferror(file);
+    }
+    free(ir_text);
+    // moved into place whole, so a concurrent compile never reads half of it
+    if (!ok || rename(tmp, path) != 0) {
+        unlink(tmp);
+    }
+}
+
+VISIT_UNDEF(CONS_PROG);
+
+VISIT(CONS_SPEC) {
+    mix(node->kind);
+    mix_str(node->str);
+}
+
+VISIT(CONS_FUN) {
+    mix_str(node->str);
+    mix_list(node->params);
+    mix_ast(node->spec);
+    mix_ast(node->body);
+}
+
+VISIT(STMT_EXPR) {
+    mix_ast(node->expr);
+}
+
+VISIT(STMT_SCOP) {
+    mix_list(node->decls);
+    mix_list(node->stmts);
+}
+
+VISIT(STMT_IFTE) {
+    mix_ast(node->cond);
+    mix_ast(node->tru_stmt);
+    mix_ast(node->fls_stmt);
+}
+
+VISIT(STMT_WHLE) {
+    mix_ast(node->cond);
+    mix_ast(node->body);
+}
+
+VISIT(STMT_RET) {
+    mix_ast(node->expr);
+}
+
+VISIT(EXPR_CALL) {
+    mix_str(node->str);
+    mix_list(node->expr);
+    syment_t *sym = sym_lookup(node->str);
+    if (sym != NULL) {
+        mix_type(sym->typ);
+        mix(sym->nparam);
+        LIST_ITER(sym->params, it) {
+            mix_type(it->typ);
+        }
+    }
+}
+
+VISIT(EXPR_IDEN) {
+    mix_str(node->str);
+    mix_type(node->sym ? node->sym->typ : NULL);
+}
+
+VISIT(EXPR_ARR) {
+    mix_ast(node->arr);
+    mix_list(node->ind);
+}
+
+VISIT(EXPR_ASS) {
+    mix_ast(node->lhs);
+    mix_ast(node->rhs);
+}
+
+VISIT(EXPR_DOT) {
+    mix_str(node->str);
+    mix_ast(node->base);
+    mix(node->field ? node->field->off : 0);
+    mix_type(node->typ);
+}
+
+VISIT(EXPR_INT) {
+    mix(node->value);
+}
+
+VISIT(EXPR_FLT) {
+    hash = fnv(hash, &node->value, sizeof(node->value));
+}
+
+VISIT(EXPR_BIN) {
+    mix(node->op);
+    mix_ast(node->lhs);
+    mix_ast(node->rhs);
+}
+
+VISIT(EXPR_UNR) {
+    mix(node->op);
+    mix_ast(node->sub);
+}
+
+VISIT(DECL_VAR) {
+    mix_str(node->str);
+    mix(node->dim);
+    for (u32 i = 0; i < node->dim; i++) {
+        mix(node->len[i]);
+    }
+    mix_ast(node->spec);
+    mix_ast(node->expr);
+    mix_type(node->sym ? node->sym->typ : NULL);
+}
+
+VISIT(DECL_TYP) {
+    mix_ast(node->spec);
+}
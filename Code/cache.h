@@ -0,0 +1,28 @@
+#pragma once
+#include "ast.h"
+#include "common.h"
+#include "ir.h"
+#include <stdbool.h>
+
+/**
+ * `-cache=DIR` keeps the final IR and code of every function in DIR,
+ * keyed by a hash of its AST, the types and callee signatures it uses
+ * and the options that shape its code. Lines count from the start of the
+ * function, and the names of temporaries, which carry them, are moved
+ * along when it has moved in the file. A function found there skips
+ * everything from `ast_gen` to `reg_alloc`. Its code is kept as a
+ * template in which callee frame sizes are still marks, since those
+ * callees may be recompiled; `mips_gen` fills them in.
+ */
+
+// off for -interp, -instrument and -ir-bin, which need the IR of every
+// function, and where the compiler binary cannot be read to tell builds apart
+bool cache_enabled();
+
+u64 cache_key(AST_t *fun);
+
+// the function `str`, starting at `line`, as cached under `key`, or NULL
+ir_fun_t *cache_load(u64 key, const char *str, u32 line);
+
+// keeps `fun` under `fun->key`, with `fun->line` where it starts, once `mips_gen` has made its template
+void cache_store(ir_fun_t *fun);
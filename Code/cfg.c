@@ -1,13 +1,14 @@
 #include "cfg.h"
 #include "common.h"
+#include "flags.h"
 #include "ir.h"
+#include "profile.h"
 #include "symtab.h"
 #include <stdbool.h>
 #include <stdio.h>
 
 const static char *EDGE_NAMES[] = {
     EDGES(STRING_LIST) "\0"};
-static u32 blk_cnt;
 
 static edge_t *fedge_alloc(block_t *from, block_t *to, edge_kind_t kind) {
     edge_t *e = zalloc(sizeof(edge_t));
@@ -71,7 +72,7 @@ block_t *block_alloc(cfg_t *cfg, ir_list instrs) {
 
     ptr->next   = cfg->blocks;
     ptr->instrs = instrs;
-    ptr->id     = blk_cnt++;
+    ptr->id     = cfg->nnode;
     LIST_ITER(instrs.head, it) {
         it->parent = ptr;
     }
@@ -84,6 +85,16 @@ block_t *block_alloc(cfg_t *cfg, ir_list instrs) {
     return ptr;
 }
 
+IR_t *block_label(block_t *blk) {
+    IR_t *head = blk->instrs.head;
+    if (head == NULL || head->kind != IR_LABEL) {
+        head         = ir_alloc(IR_LABEL);
+        head->parent = blk;
+        ir_prepend(&blk->instrs, head);
+    }
+    return head;
+}
+
 static void block_free(block_t *blk) {
     ir_list_free(&blk->instrs);
     zfree(blk);
@@ -95,7 +106,6 @@ cfg_t *cfg_build(ir_fun_t *fun) {
     ir_list instrs = fun->instrs;
     symcpy(cfg->str, fun->str);
     IR_t *done = ir_alloc(IR_LABEL);
-    blk_cnt    = 0;
 
     LIST_ITER(instrs.head, it) {
         if (is_start(it) || is_term(it->prev)) {
@@ -173,7 +183,129 @@ static bool is_leading(block_t *blk) {
     return true;
 }
 
-ir_fun_t *cfg_destruct(cfg_t *cfg) { // TODO: mem leak
+static block_t *through_succ(block_t *blk) {
+    succ_iter(blk, e) {
+        if (e->kind == EDGE_THROUGH) {
+            return e->to;
+        }
+    }
+    return NULL;
+}
+
+static block_t *place_chain(block_t *blk, ir_list *list) {
+    block_t *tail = NULL;
+    while (blk != NULL && !blk->mark) {
+        blk->mark = true;
+        ir_concat(list, blk->instrs);
+        tail = blk;
+        blk  = through_succ(blk);
+    }
+    return tail;
+}
+
+/**
+ * Whether `lhs` is likelier taken than `rhs`. Without a profile blocks
+ * go in source order, which `ast_gen` already lays out as the expected
+ * path: loops are rotated, so back edges are taken and exits are not.
+ */
+static bool likelier(const cfg_t *cfg, const edge_t *lhs, const edge_t *rhs) {
+    if (rhs == NULL) {
+        return true;
+    }
+    i64 lcnt = edge_count(cfg, lhs), rcnt = edge_count(cfg, rhs);
+    if (lcnt != rcnt) {
+        return lcnt > rcnt;
+    }
+    return lhs->to->id < rhs->to->id;
+}
+
+static void pick(const cfg_t *cfg, edge_t *e, edge_t **best) {
+    if (!e->to->mark && is_leading(e->to) && likelier(cfg, e, *best)) {
+        *best = e;
+    }
+}
+
+// the chain to place right after `tail`, so that it can be fallen into
+static block_t *next_chain(const cfg_t *cfg, block_t *tail) {
+    edge_t *best = NULL;
+    succ_iter(tail, e) {
+        pick(cfg, e, &best);
+    }
+    // `IF .. GOTO t; GOTO f` falls into t once the branch is inverted
+    if (tail->instrs.size == 1 && tail->instrs.head->kind == IR_GOTO) {
+        pred_iter(tail, e) {
+            if (e->kind == EDGE_THROUGH) {
+                succ_iter(e->to, f) {
+                    pick(cfg, f, &best);
+                }
+            }
+        }
+    }
+    return best ? best->to : NULL;
+}
+
+// the likeliest chain entered from placed blocks, else the first one left
+static block_t *any_chain(const cfg_t *cfg) {
+    edge_t  *best  = NULL;
+    block_t *first = NULL;
+    LIST_ITER(cfg->blocks, blk) {
+        if (blk->mark || !is_leading(blk)) {
+            continue;
+        }
+        if (first == NULL || blk->id < first->id) {
+            first = blk;
+        }
+        pred_iter(blk, e) {
+            if (e->to->mark) {
+                pick(cfg, e->rev, &best);
+            }
+        }
+    }
+    return best ? best->to : first;
+}
+
+static void layout(cfg_t *cfg, ir_list *list) {
+    block_t *tail = place_chain(cfg->entry, list);
+    while (true) {
+        block_t *next = tail ? next_chain(cfg, tail) : NULL;
+        if (next == NULL) {
+            next = any_chain(cfg);
+        }
+        if (next == NULL) {
+            break;
+        }
+        tail = place_chain(next, list);
+    }
+}
+
+// whether falling out of `ir` reaches `label` without executing anything
+static bool falls_to(IR_t *ir, IR_t *label) {
+    for (IR_t *it = ir->next; it != NULL && it->kind == IR_LABEL; it = it->next) {
+        if (it == label) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// drops jumps to the next instruction, inverting branches over a GOTO
+static void tidy_jumps(ir_list *list) {
+    LIST_ITER(list->head, it) {
+        if (it->mark || (it->kind != IR_GOTO && it->kind != IR_BRANCH)) {
+            continue;
+        }
+        if (falls_to(it, it->jmpto)) {
+            it->mark = true;
+        } else if (it->kind == IR_BRANCH && it->next != NULL && it->next->kind == IR_GOTO && falls_to(it->next, it->jmpto)) {
+            it->op         = op_negate(it->op);
+            it->jmpto      = it->next->jmpto;
+            it->next->mark = true;
+        }
+    }
+    ir_remove_mark(list);
+}
+
+ir_fun_t *cfg_destruct(cfg_t *cfg) {
     ir_fun_t *fun    = zalloc(sizeof(ir_fun_t));
     ir_list  *instrs = &fun->instrs;
     symcpy(fun->str, cfg->str);
@@ -181,6 +313,11 @@ ir_fun_t *cfg_destruct(cfg_t *cfg) { // TODO: mem leak
         blk->mark = false;
     }
     cfg->exit->mark = true;
+    if (!flags.O0) {
+        layout(cfg, instrs);
+        tidy_jumps(instrs);
+        return fun;
+    }
     dfs1(cfg->entry, instrs);
     LIST_ITER(cfg->blocks, blk) {
         if (is_leading(blk)) {
@@ -193,6 +330,22 @@ ir_fun_t *cfg_destruct(cfg_t *cfg) { // TODO: mem leak
     return fun;
 }
 
+void cfg_free(cfg_t *cfg) {
+#define FORALL(NODE) (true)
+    if (cfg == NULL) {
+        return;
+    }
+    cfg_free(cfg->next);
+    ir_list_free(&cfg->exit->instrs);
+    LIST_ITER(cfg->blocks, blk) {
+        LIST_REMOVE(blk->fedge, zfree, FORALL);
+        LIST_REMOVE(blk->bedge, zfree, FORALL);
+    }
+    LIST_REMOVE(cfg->blocks, zfree, FORALL);
+    zfree(cfg);
+#undef FORALL
+}
+
 void cfg_remove_mark(cfg_t *cfg) {
 #define EDGE_MARK(EDGE) (((EDGE)->to->mark) || ((EDGE)->from->mark))
     LIST_ITER(cfg->blocks, blk) {
@@ -222,6 +375,39 @@ void edge_remove_mark(cfg_t *cfg) {
 #undef EDGE_MARK
 }
 
+// clears the mark of every block the entry reaches, with a stack of the
+// next edge still to take out of each block on the path, as `post_number`
+// in `dom.c` walks
+static void reach(cfg_t *cfg) {
+    edge_t **next = zalloc(sizeof(edge_t *) * cfg->nnode);
+    u32      n    = 0;
+    cfg->entry->mark = false;
+    next[n++]        = cfg->entry->fedge;
+    while (n > 0) {
+        edge_t *e = next[n - 1];
+        if (e == NULL) {
+            n--;
+            continue;
+        }
+        next[n - 1] = e->next;
+        if (e->to->mark) {
+            e->to->mark = false;
+            next[n++]   = e->to->fedge;
+        }
+    }
+    zfree(next);
+}
+
+void cfg_remove_unreachable(cfg_t *cfg) {
+    LIST_ITER(cfg->blocks, blk) {
+        blk->mark = true;
+    }
+    reach(cfg);
+    // `cfg_destruct` needs it, even if nothing returns
+    cfg->exit->mark = false;
+    cfg_remove_mark(cfg);
+}
+
 void cfg_fprint(FILE *fout, const char *fname, cfg_t *cfgs) {
     fprintf(fout, "digraph program {\n");
     fprintf(fout, "label=\"%s\";\n", fname);
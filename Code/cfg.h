@@ -51,12 +51,24 @@ struct block_t {
 
 void edge_insert(cfg_t *cfg, block_t *from, block_t *to, edge_kind_t kind);
 
+// a block of `instrs` in `cfg`, without edges yet
+block_t *block_alloc(cfg_t *cfg, ir_list instrs);
+
+// the label `blk` starts with, given one if it has none
+IR_t *block_label(block_t *blk);
+
 cfg_t *cfg_build(ir_fun_t *fun);
 
 ir_fun_t *cfg_destruct(cfg_t *cfg);
 
+// frees the list from `cfg` but no instructions, `cfg_destruct` moved them
+void cfg_free(cfg_t *cfg);
+
 void cfg_fprint(FILE *fout, const char *fname, cfg_t *cfg);
 
 void cfg_remove_mark(cfg_t *cfg);
 
-void edge_remove_mark(cfg_t *cfg);
\ No newline at end of file
+void edge_remove_mark(cfg_t *cfg);
+
+// drops the blocks the entry cannot reach, the exit kept
+void cfg_remove_unreachable(cfg_t *cfg);
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include "cfg.h"
+#include "common.h"
+#include "ir.h"
+
+/**
+ * Shrinks the CFG `cfg_build` left one block per label: a block goes into
+ * its only predecessor when that predecessor has no other successor, and
+ * a block of labels alone is stepped over by the one edge into it. Run
+ * between the other passes, so that their dataflow sees fewer nodes.
+ */
+
+static edge_t *only(edge_t *edges) {
+    return edges != NULL && edges->next == NULL ? edges : NULL;
+}
+
+static bool only_labels(block_t *blk) {
+    LIST_ITER(blk->instrs.head, ir) {
+        if (ir->kind != IR_LABEL) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool falls_into(block_t *blk) {
+    pred_iter(blk, e) {
+        if (e->kind == EDGE_THROUGH) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// whether `cfg_destruct` may invert the branch `blk`, a lone GOTO, falls
+// out of, and place the branch target there instead
+static bool invertible(block_t *blk) {
+    pred_iter(blk, e) {
+        IR_t *br = e->to->instrs.tail;
+        if (e->kind == EDGE_THROUGH && br != NULL && br->kind == IR_BRANCH) {
+            return !falls_into(br->jmpto->parent);
+        }
+    }
+    return false;
+}
+
+// moves the only successor of `blk` into it, false if it cannot
+static bool merge(cfg_t *cfg, block_t *blk) {
+    edge_t *e = only(blk->fedge);
+    if (e == NULL || e->kind == EDGE_RETURN) {
+        return false;
+    }
+    block_t *succ = e->to;
+    IR_t    *last = blk->instrs.tail;
+    if (succ == blk || succ == cfg->exit || succ == cfg->entry || only(succ->bedge) == NULL) {
+        return false;
+    }
+    if (last != NULL && last->kind == IR_BRANCH) {
+        return false;
+    }
+    if (last != NULL && last->kind == IR_GOTO && last == blk->instrs.head && invertible(blk)) {
+        return false;
+    }
+    // nothing of either would be left, so `skip` steps over `succ` instead
+    if ((last == NULL || (last->kind == IR_GOTO && last == blk->instrs.head)) && only_labels(succ)) {
+        return false;
+    }
+
+    // nothing jumps to `succ` but `last`
+    if (last != NULL && last->kind == IR_GOTO) {
+        last->mark = true;
+        ir_remove_mark(&blk->instrs);
+    }
+    LIST_ITER(succ->instrs.head, ir) {
+        ir->mark   = ir->kind == IR_LABEL;
+        ir->parent = blk;
+    }
+    ir_remove_mark(&succ->instrs);
+    ir_concat(&blk->instrs, succ->instrs);
+    succ->instrs = (ir_list){0};
+
+    succ_iter(succ, f) {
+        edge_insert(cfg, blk, f->to, f->kind);
+        f->mark = true;
+    }
+    e->mark    = true;
+    succ->mark = true;
+    edge_remove_mark(cfg);
+    return true;
+}
+
+// sends the one edge into `blk`, a block of labels, on to where it falls
+static bool skip(cfg_t *cfg, block_t *blk) {
+    edge_t *in = only(blk->bedge), *out = only(blk->fedge);
+    if (blk == cfg->entry || in == NULL || out == NULL || !only_labels(blk)) {
+        return false;
+    }
+    block_t *from = in->to, *succ = out->to;
+    if (from == blk || succ == blk || succ == cfg->exit) {
+        return false;
+    }
+    if (in->kind != EDGE_THROUGH) {
+        from->instrs.tail->jmpto = block_label(succ);
+    }
+    edge_insert(cfg, from, succ, in->kind);
+    in->mark = out->mark = true;
+    blk->mark            = true;
+    edge_remove_mark(cfg);
+    return true;
+}
+
+void do_clean(cfg_t *cfg) {
+    cfg_remove_unreachable(cfg);
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        LIST_ITER(cfg->blocks, blk) {
+            if (!blk->mark) {
+                changed |= merge(cfg, blk) || skip(cfg, blk);
+            }
+        }
+    }
+    cfg_remove_mark(cfg);
+}
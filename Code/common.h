@@ -8,7 +8,6 @@
 #include <assert.h>
 
 #define MAX_SYM_LEN 64
-#define MAX_SYM 8192
 #define MAX_DIM 64
 #define MAX_CHAR 63
 #define SYM_STR_SIZE (sizeof(char) * MAX_SYM_LEN)
@@ -124,6 +123,22 @@ struct shared {
             }                             \
         }                                 \
     } while (0)
+// LIST_APPEND for a list whose last node is kept in TAIL, NODE may be a list
+#define LIST_APPEND_TAIL(LIST, TAIL, NODE) \
+    do {                                   \
+        __auto_type __node = (NODE);       \
+        if (__node == NULL) {              \
+            break;                         \
+        }                                  \
+        if ((LIST) == NULL) {              \
+            (LIST) = __node;               \
+        } else {                           \
+            (TAIL)->next = __node;         \
+        }                                  \
+        for ((TAIL) = __node;              \
+             (TAIL)->next != NULL;         \
+             (TAIL) = (TAIL)->next) {}     \
+    } while (0)
 #define LIST_LENGTH(LIST)                 \
     ({                                    \
         u32 __length = 0;                 \
@@ -202,4 +217,13 @@ __attribute__((unused)) static inline void *zalloc(u32 size) {
 __attribute__((unused)) static inline void zfree(void *ptr) {
     LOG("zfree @ %p", ptr);
     free(ptr);
-}
\ No newline at end of file
+}
+#define FNV_INIT 14695981039346656037ull
+
+// FNV-1a, for hashes that must agree between runs
+__attribute__((unused)) static inline u64 fnv(u64 hash, const void *data, u32 size) {
+    for (const u8 *it = data; size--; it++) {
+        hash = (hash ^ *it) * 1099511628211ull;
+    }
+    return hash;
+}
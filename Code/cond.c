@@ -9,6 +9,9 @@
 #define ARG list
 VISITOR_DEF(AST, cond, RET_TYPE);
 
+extern oprd_t value_gen(AST_t *node, oprd_t tar, ir_list *list);
+extern void   value_keep(oprd_t *oprd, ir_list *list, const ir_list *rest);
+
 ir_list cond_gen(AST_t *node) {
     ir_list ARG = {0};
     VISITOR_DISPATCH(AST, cond, node, &ARG);
@@ -16,11 +19,12 @@ ir_list cond_gen(AST_t *node) {
 }
 
 static ir_list wrapper(AST_t *node) {
-    oprd_t result_var = var_alloc(NULL, node->fst_l);
+    oprd_t  result_var = var_alloc(NULL, node->fst_l);
+    ir_list result     = {0};
+    result_var         = value_gen(node, result_var, &result);
 
-    ir_list result  = ast_gen((AST_t *) node, result_var);
-    IR_t   *cmp_tru = ir_alloc(IR_BRANCH, OP_NE, result_var, lit_alloc(0), NULL);
-    IR_t   *jmp_fls = ir_alloc(IR_GOTO, NULL);
+    IR_t *cmp_tru = ir_alloc(IR_BRANCH, OP_NE, result_var, lit_alloc(0), NULL);
+    IR_t *jmp_fls = ir_alloc(IR_GOTO, NULL);
     ir_append(&result, cmp_tru);
     ir_append(&result, jmp_fls);
     chain_insert(&result.tru, cmp_tru);
@@ -67,8 +71,9 @@ VISIT(EXPR_BIN) { // yields jmp
              cmp(op, lhs, rhs) -> tru
              goto -> fls
             */
-            lhs = ast_gen(node->lhs, lhs_var);
-            rhs = ast_gen(node->rhs, rhs_var);
+            lhs_var = value_gen(node->lhs, lhs_var, &lhs);
+            rhs_var = value_gen(node->rhs, rhs_var, &rhs);
+            value_keep(&lhs_var, &lhs, &rhs);
 
             IR_t *cmp_tru = ir_alloc(IR_BRANCH, node->op, lhs_var, rhs_var, NULL);
             IR_t *jmp_fls = ir_alloc(IR_GOTO, NULL);
@@ -57,6 +57,12 @@ static fact_t fact_compute(op_kind_t op, const fact_t lhs, const fact_t rhs) {
                 if (rhs.val == 0) return UNDEF;
                 return const_alloc((i64) lhs.val / (i64) rhs.val);
             }
+            case OP_LT: return const_alloc((i64) lhs.val < (i64) rhs.val);
+            case OP_LE: return const_alloc((i64) lhs.val <= (i64) rhs.val);
+            case OP_GT: return const_alloc((i64) lhs.val > (i64) rhs.val);
+            case OP_GE: return const_alloc((i64) lhs.val >= (i64) rhs.val);
+            case OP_EQ: return const_alloc((i64) lhs.val == (i64) rhs.val);
+            case OP_NE: return const_alloc((i64) lhs.val != (i64) rhs.val);
             default: UNREACHABLE;
         }
     }
@@ -80,6 +86,7 @@ static fact_t fact_compute(op_kind_t op, const fact_t lhs, const fact_t rhs) {
             if (IS_CONST(rhs, 0)) return UNDEF;
             return NAC;
         }
+        REL_OPS(CASE) return NAC;
         default: UNREACHABLE;
     }
     UNREACHABLE;
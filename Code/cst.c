@@ -1,9 +1,10 @@
 #include "cst.h"
 #include "common.h"
+#include "flags.h"
 #include "symtab.h"
 #include <stdarg.h>
 
-static void ins_chld(cst_t *node, cst_t *chld) {
+void cst_append(cst_t *node, cst_t *chld) {
     if (node->chld == NULL) {
         node->chld = chld;
         return;
@@ -17,6 +18,9 @@ static void ins_chld(cst_t *node, cst_t *chld) {
 }
 
 cst_t *cst_alloc(const char *typ, const char *name, u32 fst_l, u32 nchld, ...) {
+    if (!flags.cst) {
+        return NULL;
+    }
     va_list ap;
     va_start(ap, nchld);
 
@@ -28,7 +32,7 @@ cst_t *cst_alloc(const char *typ, const char *name, u32 fst_l, u32 nchld, ...) {
     node->fst_l  = fst_l;
 
     while (nchld--) {
-        ins_chld(node, va_arg(ap, cst_t *));
+        cst_append(node, va_arg(ap, cst_t *));
     }
 
     va_end(ap);
@@ -16,8 +16,12 @@ struct cst_t {
     bool   is_tok;
 };
 
+// NULL unless `-cst`, only the AST is built then
 cst_t *cst_alloc(const char *typ, const char *name, u32 fst_line, u32 nchld, ...);
 
+// adds `chld` after the children `node` has
+void cst_append(cst_t *node, cst_t *chld);
+
 void cst_free(cst_t *node);
 
 void cst_print(cst_t *node, i32 dep);
\ No newline at end of file
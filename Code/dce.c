@@ -3,7 +3,6 @@
 #include "dataflow.h"
 #include "live.h"
 #include "opt.h"
-#include "reach.h"
 
 static void remove_dead(cfg_t *cfg) {
     live_data_t *data_in  = zalloc(sizeof(live_data_t) * cfg->nnode);
@@ -37,26 +36,7 @@ static void remove_dead(cfg_t *cfg) {
     zfree(df.data_out);
 }
 
-static void remove_unreachable(cfg_t *cfg) {
-    reach_data_t *data_in  = zalloc(sizeof(reach_data_t) * cfg->nnode);
-    reach_data_t *data_out = zalloc(sizeof(reach_data_t) * cfg->nnode);
-
-    dataflow df = do_reach(data_in, data_out, cfg);
-    LIST_ITER(cfg->blocks, blk) {
-        blk->mark = false;
-    }
-    LIST_ITER(cfg->blocks, blk) {
-        reach_data_t *pd = (reach_data_t *) df.data_at(df.data_in, blk->id);
-        if (!pd->reachable) {
-            blk->mark = true;
-        }
-    }
-    cfg_remove_mark(cfg);
-    zfree(df.data_in);
-    zfree(df.data_out);
-}
-
 void do_dce(cfg_t *cfg) {
     remove_dead(cfg);
-    remove_unreachable(cfg);
+    cfg_remove_unreachable(cfg);
 }
\ No newline at end of file
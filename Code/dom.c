@@ -76,4 +76,80 @@ dataflow do_dom(void *data_in, void *data_out, cfg_t *cfg) {
     df.solve(cfg);
     set_fini(&UNIVERSE);
     return df;
+}
+
+static u32 *order;
+static u32  norder;
+
+// numbers blocks in postorder over reversed edges, from the exit, with a
+// stack of blocks and the next edge of each still to take
+static void post_number(cfg_t *cfg) {
+    block_t **blks = zalloc(sizeof(block_t *) * cfg->nnode);
+    edge_t  **next = zalloc(sizeof(edge_t *) * cfg->nnode);
+    u32       n    = 0;
+    order[cfg->exit->id] = UINT32_MAX;
+    blks[n]              = cfg->exit;
+    next[n++]            = cfg->exit->bedge;
+    while (n > 0) {
+        edge_t *e = next[n - 1];
+        if (e == NULL) {
+            order[blks[--n]->id] = ++norder;
+            continue;
+        }
+        next[n - 1] = e->next;
+        if (order[e->to->id] == 0) {
+            order[e->to->id] = UINT32_MAX;
+            blks[n]          = e->to;
+            next[n++]        = e->to->bedge;
+        }
+    }
+    zfree(blks);
+    zfree(next);
+}
+
+static block_t *intersect(block_t **ipdom, block_t *lhs, block_t *rhs) {
+    while (lhs != rhs) {
+        while (order[lhs->id] < order[rhs->id]) {
+            lhs = ipdom[lhs->id];
+        }
+        while (order[rhs->id] < order[lhs->id]) {
+            rhs = ipdom[rhs->id];
+        }
+    }
+    return lhs;
+}
+
+// Cooper, Harvey and Kennedy over reversed edges, with the blocks in
+// reverse postorder
+block_t **pdom_tree(cfg_t *cfg) {
+    block_t **ipdom  = zalloc(sizeof(block_t *) * cfg->nnode);
+    block_t **blocks = zalloc(sizeof(block_t *) * (cfg->nnode + 1));
+    order            = zalloc(sizeof(u32) * cfg->nnode);
+    norder           = 0;
+    post_number(cfg);
+    LIST_ITER(cfg->blocks, blk) {
+        blocks[order[blk->id]] = blk;
+    }
+
+    ipdom[cfg->exit->id] = cfg->exit;
+    bool changed         = true;
+    while (changed) {
+        changed = false;
+        for (u32 i = norder - 1; i > 0; i--) {
+            block_t *blk = blocks[i], *idom = NULL;
+            succ_iter(blk, e) {
+                if (ipdom[e->to->id] != NULL) {
+                    idom = idom ? intersect(ipdom, e->to, idom) : e->to;
+                }
+            }
+            if (ipdom[blk->id] != idom) {
+                ipdom[blk->id] = idom;
+                changed        = true;
+            }
+        }
+    }
+    ipdom[cfg->exit->id] = NULL;
+    zfree(order);
+    zfree(blocks);
+    return ipdom;
 }
\ No newline at end of file
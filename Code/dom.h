@@ -7,4 +7,8 @@ struct dom_data_t {
     set_t dom;
 };
 
-dataflow do_dom(void *data_in, void *data_out, cfg_t *cfg);
\ No newline at end of file
+dataflow do_dom(void *data_in, void *data_out, cfg_t *cfg);
+
+// the immediate post-dominator of every block by id, NULL for the exit and
+// for blocks that never get to it
+block_t **pdom_tree(cfg_t *cfg);
\ No newline at end of file
@@ -0,0 +1,428 @@
+#include <stdio.h>
+#include <string.h>
+#include "ast.h"
+#include "bench.h"
+#include "cache.h"
+#include "cfg.h"
+#include "common.h"
+#include "cst.h"
+#include "driver.h"
+#include "flags.h"
+#include "ir.h"
+#include "ir-bin.h"
+#include "ir-interp.h"
+#include "ir-text.h"
+#include "mips.h"
+#include "mips-enc.h"
+#include "mips-sim.h"
+#include "opt.h"
+#include "profile.h"
+
+#define LAB3
+
+void yyrestart(FILE *input_file);
+i32  yyparse(void);
+
+bool lex_err, syn_err, sem_err;
+
+cfg_t     *cfgs  = NULL;
+cst_t     *croot = NULL;
+AST_t     *root  = NULL;
+ir_fun_t  *prog  = NULL;
+ir_bin_t  *bin   = NULL;
+ir_text_t *text  = NULL;
+
+static cfg_t *cfgs_tail = NULL;
+
+jmp_buf *driver_catch = NULL;
+
+void fail() {
+    if (driver_catch != NULL) {
+        longjmp(*driver_catch, 1);
+    }
+    exit(1);
+}
+
+void done() {
+    ast_free(root);
+    root = NULL;
+}
+
+bool parse(const char *fname) {
+    FOPEN(fname, file, "r") {
+        if (!file) {
+            perror(fname);
+            fail();
+        }
+        extern i32 yylineno, yycolumn;
+        yylineno = yycolumn = 1;
+        yyrestart(file);
+        BENCH("parse", yyparse());
+    }
+    // the parse tree is only built with `-cst`
+    if (flags.cst && !lex_err && !syn_err) {
+        cst_print(croot, 0);
+        cst_free(croot);
+        croot = NULL;
+    }
+    return (lex_err || syn_err);
+}
+
+void lib_init() {
+    static AST_t dummy = (AST_t){.kind = STMT_SCOP};
+
+    syment_t *sym_read  = sym_insert("read", SYM_FUN);
+    syment_t *sym_write = sym_insert("write", SYM_FUN);
+    sym_scope_push();
+    syment_t *sym_arg = sym_insert("x", SYM_VAR);
+    sym_scope_pop();
+
+    *sym_read = (syment_t){
+        .kind   = SYM_FUN,
+        .str    = "read",
+        .body   = &dummy,
+        .typ    = &type_int,
+        .nparam = 0,
+        .params = NULL,
+        .next   = NULL};
+
+    *sym_arg = (syment_t){
+        .kind = SYM_VAR,
+        .str  = "x",
+        .typ  = &type_int,
+        .next = NULL};
+
+    *sym_write = (syment_t){
+        .kind   = SYM_FUN,
+        .str    = "write",
+        .body   = &dummy,
+        .typ    = &type_int,
+        .nparam = 1,
+        .params = sym_arg,
+        .next   = NULL};
+}
+
+bool check() {
+    symtab_init();
+    lib_init();
+    BENCH("ast_check", ast_check(root));
+    return sem_err;
+}
+
+// instructions -interp and -run execute before giving up, 0 for no limit
+u64 limit() {
+    return flags.limit ? strtoull(flags.limit, NULL, 10) : 0;
+}
+
+// executes the final IR, program I/O on stdio, counts on stderr
+void interpret(ir_fun_t *prog) {
+    interp_t *interp = interp_init(prog);
+    if (!interp) {
+        fail();
+    }
+    bool ok;
+    BENCH("interp", ok = interp_run(interp, stdin, stdout, limit()));
+    fflush(stdout);
+    interp_stat_print(stderr, interp);
+    if (flags.prof_out) {
+        FOPEN(flags.prof_out, file, "w") {
+            interp_prof_dump(file, interp);
+        }
+    }
+    if (flags.prof_ir) {
+        FOPEN(flags.prof_ir, file, "w") {
+            interp_annotate(file, interp);
+        }
+    }
+    interp_fini(interp);
+    if (!ok) {
+        fail();
+    }
+}
+
+// the emitted assembly, parsed for the simulator and the encoder
+static mips_prog *assemble(const char *sfname) {
+    mips_prog *mprog = NULL;
+    FOPEN(sfname, file, "r") {
+        mprog = mips_asm_parse(file);
+    }
+    if (!mprog) {
+        fail();
+    }
+    return mprog;
+}
+
+// writes what -obj, -raw and -disasm ask for, false if it does not encode
+static bool encode(const mips_prog *mprog) {
+    bool ok = true;
+    if (flags.obj) {
+        mcode_t *code;
+        BENCH("mips_encode", code = mips_encode(mprog, 0, 0));
+        FOPEN(flags.obj, file, "w") {
+            if (code) {
+                mips_write_elf(file, mprog, code);
+            }
+        }
+        ok = ok && code;
+        mips_code_free(code);
+    }
+    if (flags.raw || flags.disasm) {
+        mcode_t *code;
+        BENCH("mips_encode", code = mips_encode(mprog, MTEXT_BASE, MDATA_BASE));
+        if (code && flags.raw) {
+            FOPEN(flags.raw, file, "w") {
+                mips_write_raw(file, mprog, code);
+            }
+        }
+        if (code && flags.disasm) {
+            FOPEN(flags.disasm, file, "w") {
+                mips_disasm(file, mprog, code);
+            }
+        }
+        ok = ok && code;
+        mips_code_free(code);
+    }
+    return ok;
+}
+
+// simulates the emitted assembly, program I/O on stdio, counts on stderr
+static bool run(mips_prog *mprog) {
+    sim_stat_t stat = {0};
+    bool       ok;
+    BENCH("mips_sim", ok = mips_sim(mprog, stdin, stdout, limit(), &stat));
+    fflush(stdout);
+    sim_stat_print(stderr, &stat);
+    if (flags.instrument && flags.prof_out) {
+        FOPEN(flags.prof_out, file, "w") {
+            profile_dump_counters(file, prog, mprog);
+        }
+    }
+    return ok;
+}
+
+// takes `fun` from `ast_gen` down to the IR `mips_gen` expects
+static ir_fun_t *lower(ir_fun_t *fun) {
+    ir_fun_t *lowered;
+    ir_renumber(fun);
+    ir_check(&fun->instrs);
+
+    cfg_t *cfg;
+    BENCH("cfg_build", cfg = cfg_build(fun));
+    LIST_APPEND_TAIL(cfgs, cfgs_tail, cfg);
+    if (!flags.O0) {
+        optimize(cfg);
+    }
+    ir_fun_free(fun);
+    BENCH("cfg_destruct", lowered = cfg_destruct(cfg));
+    return lowered;
+}
+
+// puts the function `node` in front of `prog`, from the cache if it is there
+static void gen_fun(AST_t *node) {
+    ir_fun_t *fun = NULL;
+    u64       key = 0;
+    if (cache_enabled()) {
+        INSTANCE_OF(node, CONS_FUN) {
+            key = cache_key(node);
+            fun = cache_load(key, cnode->str, node->fst_l);
+        }
+    }
+    if (fun == NULL) {
+        ir_fun_t *rest = prog;
+        BENCH("ast_gen", ast_gen(node, (oprd_t){0}));
+        if (prog == rest) {
+            return; // only declared
+        }
+        fun       = prog;
+        prog      = rest;
+        fun->next = NULL;
+        fun       = lower(fun);
+        fun->key  = key;
+        fun->line = node->fst_l;
+    }
+    fun->next = prog;
+    prog      = fun;
+}
+
+static bool has_main() {
+    LIST_ITER(prog, fun) {
+        if (!symcmp(fun->str, "main")) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// everything after `prog` is built
+static void finish(const char *sfname, const char *ofname, const char *irname) {
+    FOPEN(irname, file, "w") {
+        if (!file) {
+            perror(irname);
+            fail();
+        }
+        BENCH("ir_print", ir_fun_print(file, prog));
+    }
+    if (flags.ir_bin) {
+        FOPEN(flags.ir_bin, file, "w") {
+            BENCH("ir_bin_write", ir_bin_write(file, prog));
+        }
+    }
+    if (flags.interp) {
+        interpret(prog);
+    }
+    if (!has_main()) {
+        fprintf(stderr, "%s: no function main\n", sfname);
+        fail();
+    }
+    FOPEN(ofname, file, "w") {
+        if (!file) {
+            perror(ofname);
+            fail();
+        }
+        BENCH("mips_gen", mips_gen(file, prog));
+    }
+    if (cache_enabled()) {
+        LIST_ITER(prog, fun) {
+            if (!fun->cached) {
+                BENCH("cache_store", cache_store(fun));
+            }
+        }
+    }
+    if (flags.run || flags.obj || flags.raw || flags.disasm) {
+        mips_prog *mprog = assemble(ofname);
+        bool       ok    = encode(mprog);
+        ok               = (!flags.run || run(mprog)) && ok;
+        mips_prog_free(mprog);
+        if (!ok) {
+            fail();
+        }
+    }
+}
+
+// what every way into `lower` needs first
+static void prepare() {
+    if (flags.prof_use && !profile_load(flags.prof_use)) {
+        fail();
+    }
+    if (flags.passes && !opt_select(flags.passes)) {
+        fail();
+    }
+    if (!loop_select(flags.loop)) {
+        fail();
+    }
+}
+
+void gen(const char *sfname, const char *ofname, const char *irname) {
+    prepare();
+    INSTANCE_OF(root, CONS_PROG) {
+        LIST_ITER(cnode->decls, it) {
+            if (it->kind == CONS_FUN) {
+                gen_fun(it);
+            }
+        }
+    }
+    finish(sfname, ofname, irname);
+}
+
+void gen_bin(const char *sfname, const char *ofname, const char *irname) {
+    prepare();
+    if (!(bin = ir_bin_open(sfname))) {
+        fail();
+    }
+    // in reverse, so that `prog` comes out in the order it was written
+    for (u32 i = ir_bin_count(bin); i-- > 0;) {
+        ir_fun_t *fun;
+        BENCH("ir_bin_read", fun = ir_bin_fun(bin, i));
+        if (fun == NULL) {
+            fprintf(stderr, "%s: function %s is malformed\n", sfname, ir_bin_name(bin, i));
+            fail();
+        }
+        fun       = lower(fun);
+        fun->next = prog;
+        prog      = fun;
+    }
+    finish(sfname, ofname, irname);
+}
+
+void gen_text(const char *sfname, const char *ofname, const char *irname) {
+    prepare();
+    BENCH("ir_text_read", text = ir_text_open(sfname));
+    if (text == NULL) {
+        fail();
+    }
+    ir_fun_t **tail = &prog;
+    for (ir_fun_t *fun = ir_text_prog(text), *next; fun != NULL; fun = next) {
+        next      = fun->next;
+        fun->next = NULL;
+        *tail     = lower(fun);
+        tail      = &(*tail)->next;
+    }
+    finish(sfname, ofname, irname);
+}
+
+bool is_bin(const char *fname) {
+    const char *dot = strrchr(fname, '.');
+    return dot != NULL && !strcmp(dot, ".irb");
+}
+
+bool is_text(const char *fname) {
+    const char *dot = strrchr(fname, '.');
+    return dot != NULL && !strcmp(dot, ".ir");
+}
+
+#define andThen ? (done()):
+
+bool compile(const char *sfname, const char *ofname, const char *irname) {
+#ifdef LAB1
+    flags.cst = true;
+    parse(sfname);
+#endif
+#ifdef LAB2
+    parse(sfname) andThen check();
+#endif
+#ifdef LAB3
+    if (is_bin(sfname)) {
+        gen_bin(sfname, ofname, irname);
+    } else if (is_text(sfname)) {
+        gen_text(sfname, ofname, irname);
+    } else {
+        parse(sfname) andThen
+            check() andThen
+            gen(sfname, ofname, irname);
+    }
+#endif
+    return (lex_err || syn_err || sem_err);
+}
+
+// drops what the last unit left behind, so the next starts afresh
+void reset() {
+    done();
+    LIST_ITER(prog, fun) {
+        ir_list_free(&fun->instrs);
+    }
+    ir_fun_free(prog);
+    prog = NULL;
+    cfg_free(cfgs);
+    cfgs      = NULL;
+    cfgs_tail = NULL;
+    if (bin) {
+        ir_bin_close(bin);
+        bin = NULL;
+    }
+    if (text) {
+        ir_text_close(text);
+        text = NULL;
+    }
+    symtab_fini();
+    profile_unload();
+    ir_reset_ids();
+    lex_err = syn_err = sem_err = false;
+}
+
+void with_ext(char *dst, u32 size, const char *fname, const char *ext) {
+    const char *dot = strrchr(fname, '.');
+    if (dot == NULL || strchr(dot, '/') != NULL) {
+        dot = fname + strlen(fname);
+    }
+    snprintf(dst, size, "%.*s%s", (i32) (dot - fname), fname, ext);
+}
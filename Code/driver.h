@@ -0,0 +1,45 @@
+#pragma once
+#include "common.h"
+#include <setjmp.h>
+#include <stdbool.h>
+
+/**
+ * The compiler as a library, one translation unit at a time. The steps
+ * report to stdout and stderr and return true on errors, like the
+ * command line does. `reset` must run before the next unit.
+ */
+
+bool parse(const char *fname);
+
+bool check();
+
+// `irname` receives the final IR, `ofname` the assembly
+void gen(const char *sfname, const char *ofname, const char *irname);
+
+// `gen` for a unit given as binary IR (see ir-bin.h), which skips the front end
+void gen_bin(const char *sfname, const char *ofname, const char *irname);
+
+// a `.irb` file, taken as binary IR
+bool is_bin(const char *fname);
+
+// `gen` for a unit given as an IR dump (see ir-text.h), `-passes` picks what runs on it
+void gen_text(const char *sfname, const char *ofname, const char *irname);
+
+// a `.ir` file, taken as an IR dump
+bool is_text(const char *fname);
+
+// the steps this LAB build runs, stopping at the first failing one
+bool compile(const char *sfname, const char *ofname, const char *irname);
+
+void reset();
+
+/**
+ * Ends the unit on a fault that leaves nothing to continue with, by
+ * exit(1), or by a long jump to `driver_catch` once it is set.
+ */
+void fail();
+
+extern jmp_buf *driver_catch;
+
+// `fname` with its extension, if any, replaced by `ext`
+void with_ext(char *dst, u32 size, const char *fname, const char *ext);
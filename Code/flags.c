@@ -0,0 +1,45 @@
+#include "flags.h"
+#include <string.h>
+
+flags_t flags;
+
+// `-prof-out` and `-prof_out` name the same flag
+static bool flag_match(const char *arg, const char *name, u32 len) {
+    for (u32 i = 0; i < len; i++) {
+        char ch = (arg[i] == '-') ? '_' : arg[i];
+        if (ch != name[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool flag_set(const char *arg) {
+    const char *eq  = strchr(arg, '=');
+    u32         len = eq ? (u32) (eq - arg) : (u32) strlen(arg);
+
+#define FLAG_BOOL_SET(NAME)                                                  \
+    if (!eq && len == strlen(#NAME) && flag_match(arg, #NAME, len)) {        \
+        flags.NAME = true;                                                   \
+        return true;                                                         \
+    }
+#define FLAG_STR_SET(NAME)                                                   \
+    if (eq && len == strlen(#NAME) && flag_match(arg, #NAME, len)) {         \
+        flags.NAME = eq + 1;                                                 \
+        return true;                                                         \
+    }
+    BOOL_FLAGS(FLAG_BOOL_SET)
+    STR_FLAGS(FLAG_STR_SET)
+    return false;
+}
+
+i32 flags_parse(i32 argc, char **argv) {
+    i32 i = 1;
+    for (; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; i++) {
+        if (!flag_set(argv[i] + 1)) {
+            fprintf(stderr, "unknown flag %s\n", argv[i]);
+            return -1;
+        }
+    }
+    return i;
+}
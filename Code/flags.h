@@ -0,0 +1,46 @@
+#pragma once
+#include "common.h"
+#include <stdbool.h>
+
+/* switches, given as `-NAME` */
+#define BOOL_FLAGS(F) \
+    F(bench)          \
+    F(run)            \
+    F(interp)         \
+    F(instrument)     \
+    F(cst)            \
+    F(batch)          \
+    F(asm_ir)         \
+    F(O0)             \
+    F(direct)         \
+    F(setcc)
+
+/* valued options, given as `-NAME=VALUE` */
+#define STR_FLAGS(F) \
+    F(limit)         \
+    F(prof_out)      \
+    F(prof_use)      \
+    F(prof_ir)       \
+    F(serve)         \
+    F(cache)         \
+    F(ir_bin)        \
+    F(passes)        \
+    F(obj)           \
+    F(raw)           \
+    F(disasm)        \
+    F(loop)
+
+#define FLAG_BOOL_FIELD(NAME) bool NAME;
+#define FLAG_STR_FIELD(NAME) const char *NAME;
+
+typedef struct flags_t flags_t;
+
+struct flags_t {
+    BOOL_FLAGS(FLAG_BOOL_FIELD)
+    STR_FLAGS(FLAG_STR_FIELD)
+};
+
+extern flags_t flags;
+
+// consumes leading `-` arguments, returns the index of the first positional one or -1
+i32 flags_parse(i32 argc, char **argv);
@@ -0,0 +1,50 @@
+#include "cfg.h"
+#include "common.h"
+#include "ir.h"
+
+// the comparison `br` tests against 0, moved into it; `t := a < b`, then
+// `if t != #0` with neither a nor b assigned in between, is `if a < b`
+static bool fuse(IR_t *br) {
+    if (br->op != OP_NE && br->op != OP_EQ) {
+        return false;
+    }
+    oprd_t var = br->lhs, zero = br->rhs;
+    if (var.kind == OPRD_LIT) {
+        swap(var, zero);
+    }
+    if (var.kind != OPRD_VAR || zero.kind != OPRD_LIT || zero.val != 0) {
+        return false;
+    }
+    LIST_REV_ITER(br->prev, it) {
+        if (!ir_defines(it, var)) {
+            continue;
+        }
+        if (it->kind != IR_BINARY) {
+            return false;
+        }
+        switch (it->op) {
+            REL_OPS(CASE) break;
+            default: return false;
+        }
+        // `it` itself included, as in `t := t == #0`
+        for (IR_t *mid = it; mid != br; mid = mid->next) {
+            if (ir_defines(mid, it->lhs) || ir_defines(mid, it->rhs)) {
+                return false;
+            }
+        }
+        br->op  = br->op == OP_NE ? it->op : op_negate(it->op);
+        br->lhs = it->lhs;
+        br->rhs = it->rhs;
+        return true;
+    }
+    return false;
+}
+
+void do_fuse(cfg_t *cfg) {
+    LIST_ITER(cfg->blocks, blk) {
+        IR_t *br = blk->instrs.tail;
+        if (br != NULL && br->kind == IR_BRANCH) {
+            while (fuse(br)) {}
+        }
+    }
+}
@@ -4,6 +4,8 @@
 #include "type.h"
 #include "visitor.h"
 #include "symtab.h"
+#include "flags.h"
+#include <string.h>
 
 #define RET_TYPE ir_list *
 #define ARG list
@@ -12,6 +14,40 @@ VISITOR_DEF(AST, gen, RET_TYPE);
 ir_list lexpr_gen(AST_t *node, oprd_t tar);
 ir_list cond_gen(AST_t *node);
 
+/*
+ twice: the test before the loop and the one at its bottom generated apart
+ clone: the bottom one cloned from the first
+ test:  a single test at the bottom, entered by a jump
+*/
+#define LOOP_MODES(F) \
+    F(twice)          \
+    F(clone)          \
+    F(test)
+
+#define LOOP_ENUM(NAME) LOOP_##NAME,
+#define LOOP_NAME(NAME) STRINGIFY(NAME),
+
+typedef enum { LOOP_MODES(LOOP_ENUM) } loop_mode_t;
+
+static const char *LOOP_NAMES[] = {LOOP_MODES(LOOP_NAME)};
+
+static loop_mode_t loop_mode = LOOP_clone;
+
+bool loop_select(const char *mode) {
+    if (mode == NULL) {
+        loop_mode = LOOP_clone;
+        return true;
+    }
+    for (u32 i = 0; i < ARR_LEN(LOOP_NAMES); i++) {
+        if (!strcmp(LOOP_NAMES[i], mode)) {
+            loop_mode = i;
+            return true;
+        }
+    }
+    fprintf(stderr, "-loop: no such way as %s\n", mode);
+    return false;
+}
+
 oprd_t oprd_stack[32768]; // should be enough
 u32    oprd_top = 0;
 
@@ -35,17 +71,143 @@ ir_list ast_gen(AST_t *node, oprd_t tar) {
     return ARG;
 }
 
+// a target nobody reads, as `-direct` gives statements
+static bool unused(oprd_t tar) {
+    return tar.kind == OPRD_LIT;
+}
+
+static oprd_t stmt_tar(u32 lineno) {
+    return flags.direct ? (oprd_t){0} : var_alloc(NULL, lineno);
+}
+
+// the value of `node` as an operand, its code appended to `list`: `tar`, or
+// with `-direct` the variable or literal a leaf names
+oprd_t value_gen(AST_t *node, oprd_t tar, ir_list *list) {
+    if (flags.direct) {
+        switch (node->kind) {
+            case EXPR_INT: {
+                INSTANCE_OF(node, EXPR_INT) {
+                    return lit_alloc(cnode->value);
+                }
+            }
+            case EXPR_IDEN: {
+                INSTANCE_OF(node, EXPR_IDEN) {
+                    return cnode->sym->var;
+                }
+            }
+            default: break;
+        }
+    }
+    ir_concat(list, ast_gen(node, tar));
+    return tar;
+}
+
+// copies a variable `value_gen` gave at the end of `list` if `rest`, which
+// runs before it is read, assigns it
+void value_keep(oprd_t *oprd, ir_list *list, const ir_list *rest) {
+    if (oprd->kind != OPRD_VAR || oprd->name == NULL) {
+        return;
+    }
+    LIST_ITER(rest->head, it) {
+        if (ir_defines(it, *oprd)) {
+            oprd_t copy = var_alloc(NULL, oprd->lineno);
+            ir_append(list, ir_alloc(IR_ASSIGN, copy, *oprd));
+            *oprd = copy;
+            return;
+        }
+    }
+}
+
 VISIT(EXPR_INT) {
     ir_list lit = {0};
     ir_append(&lit, ir_alloc(IR_ASSIGN, oprd_tar(), lit_alloc(node->value)));
     RETURN(lit);
 }
 
+// whether `node` is a comparison, && or ||, or !, whose value is 0 or 1
+static bool is_bool(AST_t *node) {
+    if (node->kind == EXPR_UNR) {
+        INSTANCE_OF(node, EXPR_UNR) {
+            return cnode->op == OP_NOT;
+        }
+    }
+    if (node->kind == EXPR_BIN) {
+        INSTANCE_OF(node, EXPR_BIN) {
+            switch (cnode->op) {
+                REL_OPS(CASE)
+                LOGIC_OPS(CASE) return true;
+                default: return false;
+            }
+        }
+    }
+    return false;
+}
+
+// `-setcc`: `tar := node != 0`
+static ir_list bool_gen(AST_t *node, oprd_t tar) {
+    if (is_bool(node)) {
+        return ast_gen(node, tar);
+    }
+    ir_list result = {0};
+    oprd_t  val    = value_gen(node, tar, &result);
+    ir_append(&result, ir_alloc(IR_BINARY, OP_NE, tar, val, lit_alloc(0)));
+    return result;
+}
+
+// `-setcc`: a comparison straight into the target, && and || branching only
+// around their right hand side
+static ir_list setcc_gen(op_kind_t op, AST_t *lhs, AST_t *rhs, u32 lineno) {
+    ir_list result = {0};
+    switch (op) {
+        REL_OPS(CASE) {
+            oprd_t  lhs_var = var_alloc(NULL, lineno);
+            oprd_t  rhs_var = var_alloc(NULL, lineno);
+            ir_list rest    = {0};
+            lhs_var         = value_gen(lhs, lhs_var, &result);
+            rhs_var         = value_gen(rhs, rhs_var, &rest);
+            value_keep(&lhs_var, &result, &rest);
+            ir_concat(&result, rest);
+            ir_append(&result, ir_alloc(IR_BINARY, op, oprd_tar(), lhs_var, rhs_var));
+            return result;
+        }
+        case OP_AND:
+        case OP_OR: {
+            /*
+             lhs -> rhs, short (&&)
+             rhs:
+             tar := rhs != 0
+             goto done
+             short:
+             tar := 0 (&&), 1 (||)
+             done:
+            */
+            result      = cond_gen(lhs);
+            IR_t *lrhs  = ir_alloc(IR_LABEL);
+            IR_t *lshrt = ir_alloc(IR_LABEL);
+            IR_t *done  = ir_alloc(IR_LABEL);
+            bool  and   = op == OP_AND;
+            chain_resolve(and ? &result.tru : &result.fls, lrhs);
+            chain_resolve(and ? &result.fls : &result.tru, lshrt);
+            ir_append(&result, lrhs);
+            ir_concat(&result, bool_gen(rhs, oprd_tar()));
+            ir_append(&result, ir_alloc(IR_GOTO, done));
+            ir_append(&result, lshrt);
+            ir_append(&result, ir_alloc(IR_ASSIGN, oprd_tar(), lit_alloc(!and)));
+            ir_append(&result, done);
+            return result;
+        }
+        default: UNREACHABLE;
+    }
+}
+
 VISIT(EXPR_BIN) {
     ir_list lhs = {0}, rhs = {0};
     switch (node->op) {
         REL_OPS(CASE)
         LOGIC_OPS(CASE) {
+            if (flags.setcc) {
+                RETURN(setcc_gen(node->op, node->lhs, node->rhs, node->super.fst_l));
+            }
             ir_list result = cond_gen((AST_t *) node);
 
             IR_t *ltru = ir_alloc(IR_LABEL);
@@ -65,8 +227,9 @@ VISIT(EXPR_BIN) {
             oprd_t lhs_var = var_alloc(NULL, node->super.fst_l);
             oprd_t rhs_var = var_alloc(NULL, node->super.fst_l);
 
-            lhs = ast_gen(node->lhs, lhs_var);
-            rhs = ast_gen(node->rhs, rhs_var);
+            lhs_var = value_gen(node->lhs, lhs_var, &lhs);
+            rhs_var = value_gen(node->rhs, rhs_var, &rhs);
+            value_keep(&lhs_var, &lhs, &rhs);
             ir_concat(&lhs, rhs);
             ir_append(&lhs, ir_alloc(IR_BINARY, node->op, oprd_tar(), lhs_var, rhs_var));
             RETURN(lhs);
@@ -79,6 +242,24 @@ VISIT(EXPR_BIN) {
 VISIT(EXPR_UNR) {
     switch (node->op) {
         case OP_NOT: {
+            if (flags.setcc) {
+                // !(a < b) is a >= b
+                if (node->sub->kind == EXPR_BIN) {
+                    INSTANCE_OF(node->sub, EXPR_BIN) {
+                        switch (cnode->op) {
+                            REL_OPS(CASE) {
+                                RETURN(setcc_gen(op_negate(cnode->op), cnode->lhs, cnode->rhs, node->super.fst_l));
+                            }
+                            default: break;
+                        }
+                    }
+                }
+                oprd_t  sub_var = var_alloc(NULL, node->super.fst_l);
+                ir_list result  = {0};
+                sub_var         = value_gen(node->sub, sub_var, &result);
+                ir_append(&result, ir_alloc(IR_BINARY, OP_EQ, oprd_tar(), sub_var, lit_alloc(0)));
+                RETURN(result);
+            }
             ir_list result = cond_gen((AST_t *) node);
 
             IR_t *ltru = ir_alloc(IR_LABEL);
@@ -96,7 +277,8 @@ VISIT(EXPR_UNR) {
         }
         case OP_NEG: {
             oprd_t  sub_var = var_alloc(NULL, node->super.fst_l);
-            ir_list result  = ast_gen(node->sub, sub_var);
+            ir_list result  = {0};
+            sub_var         = value_gen(node->sub, sub_var, &result);
             ir_append(&result, ir_alloc(IR_BINARY, OP_SUB, oprd_tar(), lit_alloc(0), sub_var));
             RETURN(result);
         }
@@ -116,15 +298,44 @@ VISIT(EXPR_IDEN) {
 VISIT(STMT_RET) {
     oprd_t expr_var = var_alloc(NULL, node->super.fst_l);
 
-    ir_list expr = ast_gen(node->expr, expr_var);
+    ir_list expr = {0};
+    expr_var     = value_gen(node->expr, expr_var, &expr);
     ir_append(&expr, ir_alloc(IR_RETURN, expr_var));
     RETURN(expr);
 }
 
 VISIT(STMT_WHLE) {
+    if (loop_mode == LOOP_test) {
+        /*
+         goto test
+         loop:
+         body
+         test:
+         cond -> loop, done
+         done:
+        */
+        ir_list cond   = cond_gen(node->cond);
+        ir_list body   = ast_gen(node->body, stmt_tar(node->super.fst_l));
+        ir_list result = {0};
+
+        IR_t *loop = ir_alloc(IR_LABEL);
+        IR_t *test = ir_alloc(IR_LABEL);
+        IR_t *done = ir_alloc(IR_LABEL);
+
+        chain_resolve(&cond.tru, loop);
+        chain_resolve(&cond.fls, done);
+
+        ir_append(&result, ir_alloc(IR_GOTO, test));
+        ir_append(&result, loop);
+        ir_concat(&result, body);
+        ir_append(&result, test);
+        ir_concat(&result, cond);
+        ir_append(&result, done);
+        RETURN(result);
+    }
     ir_list cond1  = cond_gen(node->cond);
-    ir_list cond2  = cond_gen(node->cond);
-    ir_list body   = ast_gen(node->body, var_alloc(NULL, node->super.fst_l));
+    ir_list cond2  = loop_mode == LOOP_twice ? cond_gen(node->cond) : ir_clone(&cond1);
+    ir_list body   = ast_gen(node->body, stmt_tar(node->super.fst_l));
     ir_list result = {0};
 
     IR_t *pre_hdr = ir_alloc(IR_LABEL);
@@ -147,14 +358,14 @@ VISIT(STMT_WHLE) {
 
 VISIT(STMT_IFTE) {
     ir_list cond     = cond_gen(node->cond);
-    ir_list tru_stmt = ast_gen(node->tru_stmt, var_alloc(NULL, node->super.fst_l));
+    ir_list tru_stmt = ast_gen(node->tru_stmt, stmt_tar(node->super.fst_l));
 
     IR_t *ltru = ir_alloc(IR_LABEL);
     IR_t *done = ir_alloc(IR_LABEL);
     chain_resolve(&cond.tru, ltru);
 
     if (node->fls_stmt != NULL) {
-        ir_list fls_stmt = ast_gen(node->fls_stmt, var_alloc(NULL, node->super.fst_l));
+        ir_list fls_stmt = ast_gen(node->fls_stmt, stmt_tar(node->super.fst_l));
 
         IR_t *lfls = ir_alloc(IR_LABEL);
         chain_resolve(&cond.fls, lfls);
@@ -173,10 +384,10 @@ VISIT(STMT_IFTE) {
 VISIT(STMT_SCOP) {
     ir_list result = {0};
     LIST_ITER(node->decls, it) {
-        ir_concat(&result, ast_gen(it, var_alloc(NULL, node->super.fst_l)));
+        ir_concat(&result, ast_gen(it, stmt_tar(node->super.fst_l)));
     }
     LIST_ITER(node->stmts, it) {
-        ir_concat(&result, ast_gen(it, var_alloc(NULL, node->super.fst_l)));
+        ir_concat(&result, ast_gen(it, stmt_tar(node->super.fst_l)));
     }
     RETURN(result);
 }
@@ -192,17 +403,23 @@ VISIT(EXPR_ASS) {
     if (node->lhs->kind == EXPR_IDEN) {
         INSTANCE_OF(node->lhs, EXPR_IDEN) {
             ir_list rhs = ast_gen(node->rhs, cnode->sym->var);
-            ir_append(&rhs, ir_alloc(IR_ASSIGN, oprd_tar(), cnode->sym->var));
+            if (!unused(oprd_tar())) {
+                ir_append(&rhs, ir_alloc(IR_ASSIGN, oprd_tar(), cnode->sym->var));
+            }
             RETURN(rhs);
         }
     } else {
         oprd_t  lhs_var = var_alloc(NULL, node->super.fst_l);
         oprd_t  rhs_var = var_alloc(NULL, node->super.fst_l);
         ir_list lhs     = lexpr_gen(node->lhs, lhs_var);
-        ir_list rhs     = ast_gen(node->rhs, rhs_var);
+        ir_list rhs     = {0};
+        rhs_var         = value_gen(node->rhs, rhs_var, &rhs);
+        value_keep(&rhs_var, &rhs, &lhs);
         ir_concat(&rhs, lhs);
         ir_append(&rhs, ir_alloc(IR_STORE, lhs_var, rhs_var));
-        ir_append(&rhs, ir_alloc(IR_ASSIGN, oprd_tar(), rhs_var));
+        if (!unused(oprd_tar())) {
+            ir_append(&rhs, ir_alloc(IR_ASSIGN, oprd_tar(), rhs_var));
+        }
         RETURN(rhs);
     }
     UNREACHABLE;
@@ -242,7 +459,7 @@ VISIT(DECL_VAR) {
     ir_list   decl = {0};
     syment_t *sym  = node->sym;
     oprd_t    var  = sym->var;
-    switch (sym->typ.kind) {
+    switch (sym->typ->kind) {
         case TYPE_PRIM_INT: {
             if (node->expr != NULL) {
                 ir_list expr = ast_gen(node->expr, var);
@@ -253,7 +470,7 @@ VISIT(DECL_VAR) {
         case TYPE_STRUCT:
         case TYPE_ARRAY: {
             oprd_t dummy_var = var_alloc(NULL, node->super.fst_l);
-            ir_append(&decl, ir_alloc(IR_DEC, dummy_var, lit_alloc(sym->typ.size)));
+            ir_append(&decl, ir_alloc(IR_DEC, dummy_var, lit_alloc(sym->typ->size)));
             ir_append(&decl, ir_alloc(IR_DREF, var, dummy_var));
             RETURN(decl);
         }
@@ -264,7 +481,7 @@ VISIT(DECL_VAR) {
 VISIT(EXPR_ARR) {
     oprd_t  pos = var_alloc(NULL, node->super.fst_l);
     ir_list arr = lexpr_gen((AST_t *) node, pos);
-    if (node->super.type.kind == TYPE_PRIM_INT) {
+    if (node->super.type->kind == TYPE_PRIM_INT) {
         ir_append(&arr, ir_alloc(IR_LOAD, oprd_tar(), pos));
     } else {
         ir_append(&arr, ir_alloc(IR_ASSIGN, oprd_tar(), pos));
@@ -273,30 +490,40 @@ VISIT(EXPR_ARR) {
 }
 
 VISIT(STMT_EXPR) {
-    RETURN(ast_gen(node->expr, oprd_tar()));
+    oprd_t tar = oprd_tar();
+    if (unused(tar) && node->expr->kind != EXPR_ASS && node->expr->kind != EXPR_CALL) {
+        tar = var_alloc(NULL, node->super.fst_l);
+    }
+    RETURN(ast_gen(node->expr, tar));
 }
 
 VISIT(EXPR_CALL) {
     ir_list call = {0};
+    oprd_t  tar  = unused(oprd_tar()) ? var_alloc(NULL, node->super.fst_l) : oprd_tar();
     if (!symcmp(node->str, "read")) {
-        ir_append(&call, ir_alloc(IR_READ, oprd_tar()));
+        ir_append(&call, ir_alloc(IR_READ, tar));
     } else if (!symcmp(node->str, "write")) {
         oprd_t arg_var = var_alloc(NULL, node->super.fst_l);
-        call           = ast_gen(node->expr, arg_var);
-        ir_append(&call, ir_alloc(IR_WRITE, oprd_tar(), arg_var));
-        ir_append(&call, ir_alloc(IR_ASSIGN, oprd_tar(), lit_alloc(0)));
+        arg_var        = value_gen(node->expr, arg_var, &call);
+        ir_append(&call, ir_alloc(IR_WRITE, tar, arg_var));
+        if (!unused(oprd_tar())) {
+            ir_append(&call, ir_alloc(IR_ASSIGN, tar, lit_alloc(0)));
+        }
     } else {
         ir_list arglist = {0};
         LIST_ITER(node->expr, it) {
             oprd_t  arg_var = var_alloc(NULL, node->super.fst_l);
-            ir_list arg     = ast_gen(it, arg_var);
+            ir_list arg     = {0};
+            arg_var         = value_gen(it, arg_var, &arg);
+            // the arguments before run after this one
+            value_keep(&arg_var, &arg, &call);
             ir_prepend(&arglist, ir_alloc(IR_ARG, arg_var));
             // reverse order
             ir_concat(&arg, call);
             call = arg;
         }
         ir_concat(&call, arglist);
-        ir_append(&call, ir_alloc(IR_CALL, oprd_tar(), node->str));
+        ir_append(&call, ir_alloc(IR_CALL, tar, node->str));
     }
     RETURN(call);
 }
@@ -1,19 +1,51 @@
 #include "hashtab.h"
 #include <string.h>
 
-static u32 str_hash(const char *s) {
-    u32 hash = 0;
-    for (const char *p = s; *p; p++) {
-        hash = (hash * 17 + *p) % MAX_TAB_SIZE;
+#define MIN_TAB_SIZE 64
+
+static hashent_t *probe(hashent_t *bucket, u32 cap, const char *str) {
+    u32 hash = fnv(FNV_INIT, str, strlen(str)) & (cap - 1);
+    while (bucket[hash].ptr && strcmp(bucket[hash].str, str)) {
+        hash = (hash + 1) & (cap - 1);
     }
-    return hash;
+    return &bucket[hash];
 }
 
 hashent_t *hash_lookup(hashtab_t *hashtab, const char *str) {
-    hashent_t *bucket = hashtab->bucket;
-    u32        hash   = str_hash(str);
-    while (bucket[hash].ptr && strcmp(bucket[hash].str, str)) {
-        hash = (hash + 1) % MAX_TAB_SIZE;
+    static hashent_t none;
+    if (hashtab->cap == 0) {
+        none = (hashent_t){0};
+        return &none;
     }
-    return &bucket[hash];
-}
\ No newline at end of file
+    return probe(hashtab->bucket, hashtab->cap, str);
+}
+
+static void grow(hashtab_t *hashtab) {
+    u32        cap    = hashtab->cap ? hashtab->cap * 2 : MIN_TAB_SIZE;
+    hashent_t *bucket = zalloc(sizeof(hashent_t) * cap);
+    for (u32 i = 0; i < hashtab->cap; i++) {
+        if (hashtab->bucket[i].ptr) {
+            *probe(bucket, cap, hashtab->bucket[i].str) = hashtab->bucket[i];
+        }
+    }
+    zfree(hashtab->bucket);
+    hashtab->bucket = bucket;
+    hashtab->cap    = cap;
+}
+
+hashent_t *hash_insert(hashtab_t *hashtab, const char *str) {
+    if ((hashtab->size + 1) * 2 > hashtab->cap) {
+        grow(hashtab);
+    }
+    hashent_t *ent = probe(hashtab->bucket, hashtab->cap, str);
+    if (ent->ptr == NULL) {
+        strncpy(ent->str, str, MAX_SYM_LEN - 1);
+        hashtab->size++;
+    }
+    return ent;
+}
+
+void hash_fini(hashtab_t *hashtab) {
+    zfree(hashtab->bucket);
+    *hashtab = (hashtab_t){0};
+}
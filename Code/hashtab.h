@@ -1,16 +1,21 @@
 #pragma once
 #include "common.h"
 
-#define MAX_TAB_SIZE 8192
-
 typedef struct hashent_t {
     char  str[MAX_SYM_LEN];
     void *ptr;
 } hashent_t;
 
+// open addressing, twice the room of what it holds
 typedef struct {
-    hashent_t bucket[MAX_TAB_SIZE];
-    u32       size;
+    hashent_t *bucket;
+    u32        size, cap;
 } hashtab_t;
 
+// the entry of `str`, one with a NULL `ptr` if there is none
 hashent_t *hash_lookup(hashtab_t *hashtab, const char *str);
+
+// the entry of `str`, made if there is none, which the caller then gives a `ptr`
+hashent_t *hash_insert(hashtab_t *hashtab, const char *str);
+
+void hash_fini(hashtab_t *hashtab);
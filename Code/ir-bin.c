@@ -0,0 +1,423 @@
+#define _DEFAULT_SOURCE
+#include "ir-bin.h"
+#include "map.h"
+#include "symtab.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MAGIC "CMMIRB"
+#define VERSION 1
+
+// what an instruction of each kind carries
+enum {
+    F_OP  = 1,
+    F_TAR = 2,
+    F_LHS = 4,
+    F_RHS = 8,
+    F_JMP = 16,
+    F_STR = 32,
+};
+
+static const u8 FIELDS[] = {
+    [IR_LABEL]  = F_STR,
+    [IR_ASSIGN] = F_TAR | F_LHS,
+    [IR_BINARY] = F_OP | F_TAR | F_LHS | F_RHS,
+    [IR_DREF]   = F_TAR | F_LHS,
+    [IR_LOAD]   = F_TAR | F_LHS,
+    [IR_STORE]  = F_TAR | F_LHS,
+    [IR_GOTO]   = F_JMP,
+    [IR_BRANCH] = F_OP | F_LHS | F_RHS | F_JMP,
+    [IR_RETURN] = F_LHS,
+    [IR_DEC]    = F_TAR | F_LHS,
+    [IR_ARG]    = F_LHS,
+    [IR_CALL]   = F_TAR | F_STR,
+    [IR_PARAM]  = F_TAR,
+    [IR_READ]   = F_TAR,
+    [IR_WRITE]  = F_TAR | F_LHS,
+};
+
+static u64 zigzag(i64 val) {
+    return ((u64) val << 1) ^ (u64) (val >> 63);
+}
+
+static i64 unzigzag(u64 val) {
+    return (i64) (val >> 1) ^ -(i64) (val & 1);
+}
+
+typedef struct {
+    u8 *data;
+    u32 size, cap;
+} buf_t;
+
+static void put(buf_t *buf, const void *data, u32 size) {
+    if (buf->size + size > buf->cap) {
+        buf->cap  = max(buf->cap * 2, buf->size + size);
+        buf->data = realloc(buf->data, buf->cap);
+    }
+    memcpy(buf->data + buf->size, data, size);
+    buf->size += size;
+}
+
+static void put_num(buf_t *buf, u64 val) {
+    u8  bytes[10];
+    u32 n = 0;
+    do {
+        bytes[n] = val & 0x7f;
+        val >>= 7;
+        bytes[n++] |= val ? 0x80 : 0;
+    } while (val);
+    put(buf, bytes, n);
+}
+
+// NULL as length 0, others as their length plus one
+static void put_str(buf_t *buf, const char *str) {
+    if (str == NULL) {
+        put_num(buf, 0);
+        return;
+    }
+    u32 len = strlen(str);
+    put_num(buf, len + 1);
+    put(buf, str, len + 1);
+}
+
+typedef struct {
+    uptr *ids;
+    u32   n;
+} ids_t;
+
+static void put_oprd(buf_t *buf, const ids_t *vars, oprd_t oprd) {
+    if (oprd.kind == OPRD_LIT && zigzag(oprd.val) >> 63) {
+        // too wide to shift, the index past the last variable escapes it
+        put_num(buf, (u64) vars->n << 1);
+        put_num(buf, zigzag(oprd.val));
+    } else if (oprd.kind == OPRD_LIT) {
+        put_num(buf, zigzag(oprd.val) << 1 | 1);
+    } else {
+        put_num(buf, (u64) (ir_ids_rank(vars->ids, vars->n, oprd.id) - 1) << 1);
+    }
+}
+
+static void write_fun(buf_t *buf, ir_fun_t *fun) {
+    u32   ninstr = 0;
+    map_t pos;
+    map_init(&pos);
+    LIST_ITER(fun->instrs.head, it) {
+        map_insert(&pos, it, (void *) (uptr) ++ninstr);
+    }
+
+    ids_t vars = {zalloc(sizeof(uptr) * (ninstr * 3 + 1)), 0};
+    ids_t jmps = {zalloc(sizeof(uptr) * (ninstr + 1)), 0};
+    LIST_ITER(fun->instrs.head, it) {
+#define COLLECT(OPRD)                   \
+    if ((OPRD).kind == OPRD_VAR) {      \
+        vars.ids[vars.n++] = (OPRD).id; \
+    }
+        COLLECT(it->tar)
+        COLLECT(it->lhs)
+        COLLECT(it->rhs)
+        if (FIELDS[it->kind] & F_JMP) {
+            jmps.ids[jmps.n++] = (uptr) map_find(&pos, it->jmpto);
+        }
+    }
+    vars.n = ir_ids_uniq(vars.ids, vars.n);
+    jmps.n = ir_ids_uniq(jmps.ids, jmps.n);
+
+    // a variable is named and lined alike wherever it appears
+    const oprd_t **var_of = zalloc(sizeof(oprd_t *) * (vars.n + 1));
+    LIST_ITER(fun->instrs.head, it) {
+        const oprd_t *oprds[] = {&it->tar, &it->lhs, &it->rhs};
+        for (u32 i = 0; i < ARR_LEN(oprds); i++) {
+            if (oprds[i]->kind == OPRD_VAR) {
+                var_of[ir_ids_rank(vars.ids, vars.n, oprds[i]->id) - 1] = oprds[i];
+            }
+        }
+    }
+    put_num(buf, vars.n);
+    for (u32 i = 0; i < vars.n; i++) {
+        put_num(buf, var_of[i]->lineno);
+        put_str(buf, var_of[i]->name);
+    }
+    put_num(buf, jmps.n);
+    for (u32 i = 0; i < jmps.n; i++) {
+        put_num(buf, jmps.ids[i] - 1);
+    }
+
+    put_num(buf, ninstr);
+    u32 id = 0;
+    LIST_ITER(fun->instrs.head, it) {
+        u8 fields = FIELDS[it->kind];
+        put_num(buf, it->kind);
+        if (fields & F_OP) {
+            put_num(buf, it->op);
+        }
+        put_num(buf, zigzag((i64) it->id - id));
+        id = it->id;
+        if (fields & F_TAR) {
+            put_oprd(buf, &vars, it->tar);
+        }
+        if (fields & F_LHS) {
+            put_oprd(buf, &vars, it->lhs);
+        }
+        if (fields & F_RHS) {
+            put_oprd(buf, &vars, it->rhs);
+        }
+        if (fields & F_JMP) {
+            put_num(buf, ir_ids_rank(jmps.ids, jmps.n, (uptr) map_find(&pos, it->jmpto)) - 1);
+        }
+        if (fields & F_STR) {
+            put_str(buf, it->str);
+        }
+    }
+    zfree(var_of);
+    zfree(vars.ids);
+    zfree(jmps.ids);
+    map_fini(&pos);
+}
+
+void ir_bin_write(FILE *file, ir_fun_t *prog) {
+    buf_t index = {0}, body = {0};
+    u8    version = VERSION;
+    put(&index, MAGIC, strlen(MAGIC));
+    put(&index, &version, 1);
+    put_num(&index, LIST_LENGTH(prog));
+    LIST_ITER(prog, fun) {
+        u32 offset = body.size;
+        write_fun(&body, fun);
+        put_str(&index, fun->str);
+        put_num(&index, offset);
+        put_num(&index, body.size - offset);
+    }
+    fwrite(index.data, 1, index.size, file);
+    fwrite(body.data, 1, body.size, file);
+    free(index.data);
+    free(body.data);
+}
+
+typedef struct {
+    const char *name;
+    const u8   *data;
+    u32         offset, size;
+} section_t;
+
+struct ir_bin_t {
+    u8        *map;
+    u32        size, nfun;
+    section_t *funs;
+};
+
+// reads from `p` up to `end`, `bad` once it ran over or met nonsense
+typedef struct {
+    const u8 *p, *end;
+    bool      bad;
+} cur_t;
+
+static u64 get_num(cur_t *cur) {
+    u64 val = 0;
+    for (u32 shift = 0; shift < 64 && cur->p < cur->end; shift += 7) {
+        u8 byte = *cur->p++;
+        val |= (u64) (byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return val;
+        }
+    }
+    cur->bad = true;
+    return 0;
+}
+
+static u64 get_below(cur_t *cur, u64 bound) {
+    u64 val = get_num(cur);
+    if (val >= bound) {
+        cur->bad = true;
+        return 0;
+    }
+    return val;
+}
+
+static const char *get_str(cur_t *cur) {
+    u64 len = get_num(cur);
+    if (len == 0 || cur->bad) {
+        return NULL;
+    }
+    if (len > (u64) (cur->end - cur->p) || cur->p[len - 1] != '\0') {
+        cur->bad = true;
+        return NULL;
+    }
+    const char *str = (const char *) cur->p;
+    cur->p += len;
+    return str;
+}
+
+ir_bin_t *ir_bin_open(const char *fname) {
+    i32 fd = open(fname, O_RDONLY);
+    if (fd < 0) {
+        perror(fname);
+        return NULL;
+    }
+    struct stat st;
+    u8         *map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "%s: cannot map\n", fname);
+        return NULL;
+    }
+
+    ir_bin_t *bin = zalloc(sizeof(ir_bin_t));
+    bin->map      = map;
+    bin->size     = st.st_size;
+    cur_t cur     = {map, map + bin->size, false};
+    u32   len     = strlen(MAGIC);
+    if (bin->size <= len || memcmp(map, MAGIC, len) || map[len] != VERSION) {
+        cur.bad = true;
+    } else {
+        cur.p += len + 1;
+        bin->nfun = get_below(&cur, bin->size);
+        bin->funs = zalloc(sizeof(section_t) * (bin->nfun + 1));
+        for (u32 i = 0; i < bin->nfun && !cur.bad; i++) {
+            bin->funs[i].name = get_str(&cur);
+            bin->funs[i].offset = get_num(&cur);
+            bin->funs[i].size   = get_num(&cur);
+        }
+    }
+    // offsets count from the end of the index
+    for (u32 i = 0; i < bin->nfun && !cur.bad; i++) {
+        section_t *sec  = &bin->funs[i];
+        uptr       left = cur.end - cur.p;
+        if (sec->name == NULL || sec->offset > left || sec->size > left - sec->offset) {
+            cur.bad = true;
+        }
+        sec->data = cur.p + sec->offset;
+    }
+    if (cur.bad) {
+        fprintf(stderr, "%s: not binary IR\n", fname);
+        ir_bin_close(bin);
+        return NULL;
+    }
+    return bin;
+}
+
+void ir_bin_close(ir_bin_t *bin) {
+    munmap(bin->map, bin->size);
+    zfree(bin->funs);
+    zfree(bin);
+}
+
+u32 ir_bin_count(const ir_bin_t *bin) {
+    return bin->nfun;
+}
+
+const char *ir_bin_name(const ir_bin_t *bin, u32 i) {
+    return bin->funs[i].name;
+}
+
+static oprd_t get_oprd(cur_t *cur, const oprd_t *vars, u32 nvar) {
+    u64 val = get_num(cur);
+    if (val & 1) {
+        return lit_alloc(unzigzag(val >> 1));
+    }
+    if ((val >> 1) == nvar) {
+        return lit_alloc(unzigzag(get_num(cur)));
+    }
+    if ((val >> 1) > nvar) {
+        cur->bad = true;
+        return lit_alloc(0);
+    }
+    return vars[val >> 1];
+}
+
+ir_fun_t *ir_bin_fun(const ir_bin_t *bin, u32 i) {
+    const section_t *sec = &bin->funs[i];
+    cur_t            cur = {sec->data, sec->data + sec->size, false};
+    ir_fun_t        *fun = zalloc(sizeof(ir_fun_t));
+    symcpy(fun->str, sec->name);
+
+    // every entry takes at least one byte, which bounds the counts
+    u32     nvar = get_below(&cur, sec->size + 1);
+    oprd_t *vars = zalloc(sizeof(oprd_t) * (nvar + 1));
+    for (u32 j = 0; j < nvar && !cur.bad; j++) {
+        vars[j].kind   = OPRD_VAR;
+        vars[j].id     = j + 2;
+        vars[j].lineno = get_num(&cur);
+        vars[j].name   = get_str(&cur);
+    }
+    u32  njmp = get_below(&cur, sec->size + 1);
+    u32 *jmps = zalloc(sizeof(u32) * (njmp + 1));
+    for (u32 j = 0; j < njmp && !cur.bad; j++) {
+        jmps[j] = get_num(&cur);
+    }
+
+    u32    ninstr = get_below(&cur, sec->size + 1);
+    IR_t **instrs = zalloc(sizeof(IR_t *) * (ninstr + 1));
+    u32   *jmp_of = zalloc(sizeof(u32) * (ninstr + 1));
+    i64    id     = 0;
+    for (u32 j = 0; j < ninstr && !cur.bad; j++) {
+        IR_t *ir = zalloc(sizeof(IR_t));
+        ir_append(&fun->instrs, ir);
+        instrs[j] = ir;
+        ir->kind  = get_below(&cur, ARR_LEN(FIELDS));
+        u8 fields = FIELDS[ir->kind];
+        if (ir->kind == IR_NULL) {
+            cur.bad = true;
+        }
+        if (fields & F_OP) {
+            // as the text reader takes them
+            ir->op = get_below(&cur, OP_NE + 1);
+            if (ir->kind == IR_BRANCH && ir->op < OP_LT) {
+                cur.bad = true;
+            }
+        }
+        id += unzigzag(get_num(&cur));
+        ir->id = id;
+        if (fields & F_TAR) {
+            ir->tar = get_oprd(&cur, vars, nvar);
+        }
+        if (fields & F_LHS) {
+            ir->lhs = get_oprd(&cur, vars, nvar);
+        }
+        if (fields & F_RHS) {
+            ir->rhs = get_oprd(&cur, vars, nvar);
+        }
+        if (fields & F_JMP) {
+            jmp_of[j] = get_below(&cur, njmp);
+        }
+        if (fields & F_STR) {
+            const char *str = get_str(&cur);
+            symcpy(ir->str, str ? str : "");
+        }
+    }
+    for (u32 j = 0; j < ninstr && !cur.bad; j++) {
+        if (FIELDS[instrs[j]->kind] & F_JMP) {
+            u32 to = jmps[jmp_of[j]];
+            if (to >= ninstr || instrs[to]->kind != IR_LABEL) {
+                cur.bad = true;
+            } else {
+                instrs[j]->jmpto = instrs[to];
+            }
+        }
+    }
+    zfree(vars);
+    zfree(jmps);
+    zfree(instrs);
+    zfree(jmp_of);
+    if (cur.bad) {
+        ir_list_free(&fun->instrs);
+        ir_fun_free(fun);
+        return NULL;
+    }
+    return fun;
+}
+
+ir_fun_t *ir_bin_find(const ir_bin_t *bin, const char *str) {
+    for (u32 i = 0; i < bin->nfun; i++) {
+        if (!strcmp(bin->funs[i].name, str)) {
+            return ir_bin_fun(bin, i);
+        }
+    }
+    return NULL;
+}
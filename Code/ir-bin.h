@@ -0,0 +1,47 @@
+#pragma once
+#include "common.h"
+#include "ir.h"
+#include <stdbool.h>
+
+/**
+ * Binary IR, to hand the output of one run to the next. Numbers are
+ * unsigned LEB128 varints, a file is
+ *
+ *   "CMMIRB" version nfun
+ *   { len name \0 offset size }*nfun     the index, offsets count from its end
+ *   { section }*nfun
+ *
+ * and the section of a function is
+ *
+ *   nvar { lineno len+1 [name \0] }*nvar  variables, in the order of their ids
+ *   njmp { position }*njmp               jump targets, by position in the body
+ *   ninstr { kind [op] id operands.. }*ninstr
+ *
+ * An operand is the index of a variable shifted left, or a zigzagged
+ * literal shifted left with the low bit set; a literal too wide for that
+ * follows the index one past the last variable. Jumps name their target by
+ * index in the target table, instruction ids are deltas from the one
+ * before; ids are kept, as profiles refer to them.
+ */
+
+typedef struct ir_bin_t ir_bin_t;
+
+// writes `prog` in list order
+void ir_bin_write(FILE *file, ir_fun_t *prog);
+
+// maps `fname`, NULL after reporting to stderr if that fails or it is not binary IR
+ir_bin_t *ir_bin_open(const char *fname);
+
+// variable names of the functions read point into the mapping, close it after them
+void ir_bin_close(ir_bin_t *bin);
+
+u32 ir_bin_count(const ir_bin_t *bin);
+
+const char *ir_bin_name(const ir_bin_t *bin, u32 i);
+
+// decodes the `i`th function only now, NULL if its section is malformed or
+// holds an operator or jump the compiler never makes
+ir_fun_t *ir_bin_fun(const ir_bin_t *bin, u32 i);
+
+// the function `str`, NULL if there is none
+ir_fun_t *ir_bin_find(const ir_bin_t *bin, const char *str);
@@ -0,0 +1,466 @@
+#include "ir-interp.h"
+#include "map.h"
+#include "symtab.h"
+#include <stdarg.h>
+#include <string.h>
+
+#define MEM_BASE 0x1000
+#define NO_SLOT ((u32) -1)
+
+extern const char *IR_NAMES[];
+
+// a literal, or a variable slot in the frame
+typedef struct {
+    bool lit;
+    i32  val;
+} xoprd_t;
+
+typedef struct {
+    IR_t     *ir;
+    ir_kind_t kind;
+    op_kind_t op;
+    xoprd_t   tar, lhs, rhs;
+    u32       aux; // jump target, `DEC` object offset or callee
+} xinst_t;
+
+typedef struct {
+    ir_fun_t *fun;
+    xinst_t  *code;
+    u64      *count, *taken;
+    u32       ncode, nslot, nmem;
+} xfun_t;
+
+typedef struct {
+    xfun_t *fun;
+    u32     pc;
+    u32     vbase, mbase;
+    u32     pbase, nparam, narg; // own arguments are args[pbase, pbase + narg)
+    u32     abase;               // arguments pushed for the next call start here
+} frame_t;
+
+struct interp_t {
+    xfun_t *funs;
+    u32     nfun;
+
+    i32     *vals;
+    u8      *mem;
+    i32     *args;
+    frame_t *frames;
+    u32      nval, nmem, narg, nframe;
+    u32      cap_val, cap_mem, cap_arg, cap_frame;
+    xfun_t  *cur;
+};
+
+static void *grow(void *arr, u32 *cap, u32 need, u32 size) {
+    if (need <= *cap) {
+        return arr;
+    }
+    while (*cap < need) {
+        *cap = *cap ? *cap * 2 : 256;
+    }
+    return realloc(arr, (size_t) *cap * size);
+}
+
+static bool fault(interp_t *interp, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    fprintf(stderr, "interp: ");
+    vfprintf(stderr, fmt, ap);
+    if (interp->cur) {
+        fprintf(stderr, " in %s", interp->cur->fun->str);
+    }
+    fprintf(stderr, "\n");
+    va_end(ap);
+    return false;
+}
+
+static i32 fun_cmp(const void *lhs, const void *rhs) {
+    return strcmp(((const xfun_t *) lhs)->fun->str, ((const xfun_t *) rhs)->fun->str);
+}
+
+static xfun_t *fun_find(interp_t *interp, const char *str) {
+    ir_fun_t fun;
+    xfun_t   key = {.fun = &fun};
+    symcpy(fun.str, str);
+    return bsearch(&key, interp->funs, interp->nfun, sizeof(xfun_t), fun_cmp);
+}
+
+static u32 oprd_max_id(const IR_t *ir) {
+    u32 id = 0;
+    if (ir->tar.kind == OPRD_VAR) id = max(id, (u32) ir->tar.id);
+    if (ir->lhs.kind == OPRD_VAR) id = max(id, (u32) ir->lhs.id);
+    if (ir->rhs.kind == OPRD_VAR) id = max(id, (u32) ir->rhs.id);
+    return id;
+}
+
+static xoprd_t decode_oprd(xfun_t *xfun, u32 *slot_of, const oprd_t *oprd) {
+    if (oprd->kind == OPRD_LIT) {
+        return (xoprd_t){.lit = true, .val = (i32) oprd->val};
+    }
+    if (slot_of[oprd->id] == NO_SLOT) {
+        slot_of[oprd->id] = xfun->nslot++;
+    }
+    return (xoprd_t){.val = slot_of[oprd->id]};
+}
+
+static u32 decode_obj(xfun_t *xfun, u32 *obj_of, const oprd_t *oprd, u32 size) {
+    if (obj_of[oprd->id] == NO_SLOT) {
+        obj_of[oprd->id] = xfun->nmem;
+        xfun->nmem += (size + 3) / 4 * 4;
+    }
+    return obj_of[oprd->id];
+}
+
+static void forget(u32 *ids, const oprd_t *oprd) {
+    if (oprd->kind == OPRD_VAR) {
+        ids[oprd->id] = NO_SLOT;
+    }
+}
+
+static bool decode(interp_t *interp, xfun_t *xfun, u32 *slot_of, u32 *obj_of) {
+    ir_fun_t *fun = xfun->fun;
+    u32       pc  = 0;
+    map_t     labels;
+
+    xfun->ncode = LIST_LENGTH(fun->instrs.head);
+    xfun->code  = zalloc(sizeof(xinst_t) * xfun->ncode);
+    xfun->count = zalloc(sizeof(u64) * xfun->ncode);
+    xfun->taken = zalloc(sizeof(u64) * xfun->ncode);
+    map_init(&labels);
+    LIST_ITER(fun->instrs.head, it) {
+        if (it->kind == IR_LABEL) {
+            map_insert(&labels, it, (void *) (uptr) (pc + 1));
+        } else if (it->kind == IR_DEC) {
+            decode_obj(xfun, obj_of, &it->tar, it->lhs.val);
+        }
+        xfun->code[pc++] = (xinst_t){.ir = it, .kind = it->kind, .op = it->op};
+    }
+    for (pc = 0; pc < xfun->ncode; pc++) {
+        xinst_t *x  = &xfun->code[pc];
+        IR_t    *ir = x->ir;
+        switch (ir->kind) {
+            case IR_DEC: break;
+            case IR_DREF: {
+                x->tar = decode_oprd(xfun, slot_of, &ir->tar);
+                x->aux = decode_obj(xfun, obj_of, &ir->lhs, 4);
+                break;
+            }
+            case IR_GOTO:
+            case IR_BRANCH: {
+                x->lhs = decode_oprd(xfun, slot_of, &ir->lhs);
+                x->rhs = decode_oprd(xfun, slot_of, &ir->rhs);
+                uptr to = (uptr) map_find(&labels, ir->jmpto);
+                if (to == 0) {
+                    map_fini(&labels);
+                    return fault(interp, "jump to a missing %s", ir->jmpto->str);
+                }
+                x->aux = to - 1;
+                break;
+            }
+            case IR_CALL: {
+                x->tar        = decode_oprd(xfun, slot_of, &ir->tar);
+                xfun_t *xcall = fun_find(interp, ir->str);
+                if (!xcall) {
+                    map_fini(&labels);
+                    return fault(interp, "call to unknown %s", ir->str);
+                }
+                x->aux = xcall - interp->funs;
+                break;
+            }
+            default: {
+                x->tar = decode_oprd(xfun, slot_of, &ir->tar);
+                x->lhs = decode_oprd(xfun, slot_of, &ir->lhs);
+                x->rhs = decode_oprd(xfun, slot_of, &ir->rhs);
+                break;
+            }
+        }
+    }
+    map_fini(&labels);
+    // ids are unique to a function, forget them for the next one
+    LIST_ITER(fun->instrs.head, it) {
+        forget(slot_of, &it->tar), forget(slot_of, &it->lhs), forget(slot_of, &it->rhs);
+        forget(obj_of, &it->tar), forget(obj_of, &it->lhs);
+    }
+    return true;
+}
+
+interp_t *interp_init(ir_fun_t *prog) {
+    interp_t *interp = zalloc(sizeof(interp_t));
+    u32       nid    = 0;
+
+    interp->nfun = LIST_LENGTH(prog);
+    interp->funs = zalloc(sizeof(xfun_t) * interp->nfun);
+    u32 i        = 0;
+    LIST_ITER(prog, fun) {
+        interp->funs[i++].fun = fun;
+        LIST_ITER(fun->instrs.head, it) {
+            nid = max(nid, oprd_max_id(it) + 1);
+        }
+    }
+    qsort(interp->funs, interp->nfun, sizeof(xfun_t), fun_cmp);
+
+    u32 *slot_of = malloc(sizeof(u32) * nid);
+    u32 *obj_of  = malloc(sizeof(u32) * nid);
+    memset(slot_of, 0xff, sizeof(u32) * nid);
+    memset(obj_of, 0xff, sizeof(u32) * nid);
+    bool ok = true;
+    for (i = 0; ok && i < interp->nfun; i++) {
+        interp->cur = &interp->funs[i];
+        ok          = decode(interp, interp->cur, slot_of, obj_of);
+    }
+    interp->cur = NULL;
+    free(slot_of);
+    free(obj_of);
+    if (!ok) {
+        interp_fini(interp);
+        return NULL;
+    }
+    return interp;
+}
+
+void interp_fini(interp_t *interp) {
+    for (u32 i = 0; i < interp->nfun; i++) {
+        zfree(interp->funs[i].code);
+        zfree(interp->funs[i].count);
+        zfree(interp->funs[i].taken);
+    }
+    zfree(interp->funs);
+    free(interp->vals);
+    free(interp->mem);
+    free(interp->args);
+    free(interp->frames);
+    zfree(interp);
+}
+
+static void push_frame(interp_t *interp, xfun_t *fun, u32 pbase, u32 narg) {
+    interp->frames = grow(interp->frames, &interp->cap_frame, interp->nframe + 1, sizeof(frame_t));
+    interp->vals   = grow(interp->vals, &interp->cap_val, interp->nval + fun->nslot, sizeof(i32));
+    interp->mem    = grow(interp->mem, &interp->cap_mem, interp->nmem + fun->nmem, 1);
+    memset(interp->vals + interp->nval, 0, sizeof(i32) * fun->nslot);
+    memset(interp->mem + interp->nmem, 0, fun->nmem);
+
+    interp->frames[interp->nframe++] = (frame_t){
+        .fun   = fun,
+        .vbase = interp->nval,
+        .mbase = interp->nmem,
+        .pbase = pbase,
+        .narg  = narg,
+        .abase = interp->narg,
+    };
+    interp->nval += fun->nslot;
+    interp->nmem += fun->nmem;
+}
+
+static i32 *mem_at(interp_t *interp, i32 addr) {
+    u32 off = (u32) addr - MEM_BASE;
+    if ((u32) addr < MEM_BASE || off % 4 != 0 || off + 4 > interp->nmem) {
+        return NULL;
+    }
+    return (i32 *) (interp->mem + off);
+}
+
+bool interp_run(interp_t *interp, FILE *in, FILE *out, u64 limit) {
+    xfun_t *fmain = fun_find(interp, "main");
+    if (!fmain) {
+        return fault(interp, "no main");
+    }
+    push_frame(interp, fmain, 0, 0);
+
+    for (u64 step = 1; interp->nframe; step++) {
+        frame_t *fr = &interp->frames[interp->nframe - 1];
+        xfun_t  *f  = fr->fun;
+        interp->cur = f;
+        if (fr->pc >= f->ncode) {
+            return fault(interp, "fell off the end");
+        }
+        if (limit && step > limit) {
+            return fault(interp, "gave up after %lu instructions", limit);
+        }
+        u32      pc = fr->pc++;
+        xinst_t *x  = &f->code[pc];
+        i32     *v  = interp->vals + fr->vbase;
+        f->count[pc]++;
+
+#define VAL(O) ((O).lit ? (O).val : v[(O).val])
+        switch (x->kind) {
+            case IR_LABEL:
+            case IR_DEC: break;
+            case IR_ASSIGN: {
+                v[x->tar.val] = VAL(x->lhs);
+                break;
+            }
+            case IR_BINARY: {
+                u32 lhs = VAL(x->lhs), rhs = VAL(x->rhs), res = 0;
+                switch (x->op) {
+                    case OP_ADD: res = lhs + rhs; break;
+                    case OP_SUB: res = lhs - rhs; break;
+                    case OP_MUL: res = lhs * rhs; break;
+                    case OP_DIV: {
+                        if (rhs == 0) {
+                            return fault(interp, "division by zero");
+                        }
+                        res = ((i32) lhs == INT32_MIN && (i32) rhs == -1) ? lhs : (u32) ((i32) lhs / (i32) rhs);
+                        break;
+                    }
+                    case OP_EQ: res = lhs == rhs; break;
+                    case OP_NE: res = lhs != rhs; break;
+                    case OP_LT: res = (i32) lhs < (i32) rhs; break;
+                    case OP_LE: res = (i32) lhs <= (i32) rhs; break;
+                    case OP_GT: res = (i32) lhs > (i32) rhs; break;
+                    case OP_GE: res = (i32) lhs >= (i32) rhs; break;
+                    default: UNREACHABLE;
+                }
+                v[x->tar.val] = (i32) res;
+                break;
+            }
+            case IR_DREF: {
+                v[x->tar.val] = MEM_BASE + fr->mbase + x->aux;
+                break;
+            }
+            case IR_LOAD: {
+                i32 *ptr = mem_at(interp, VAL(x->lhs));
+                if (!ptr) {
+                    return fault(interp, "bad load from %d", VAL(x->lhs));
+                }
+                v[x->tar.val] = *ptr;
+                break;
+            }
+            case IR_STORE: {
+                i32 *ptr = mem_at(interp, VAL(x->tar));
+                if (!ptr) {
+                    return fault(interp, "bad store to %d", VAL(x->tar));
+                }
+                *ptr = VAL(x->lhs);
+                break;
+            }
+            case IR_GOTO: {
+                fr->pc = x->aux;
+                break;
+            }
+            case IR_BRANCH: {
+                i32  lhs = VAL(x->lhs), rhs = VAL(x->rhs);
+                bool cond;
+                switch (x->op) {
+                    case OP_EQ: cond = lhs == rhs; break;
+                    case OP_NE: cond = lhs != rhs; break;
+                    case OP_LT: cond = lhs < rhs; break;
+                    case OP_LE: cond = lhs <= rhs; break;
+                    case OP_GT: cond = lhs > rhs; break;
+                    case OP_GE: cond = lhs >= rhs; break;
+                    default: UNREACHABLE;
+                }
+                if (cond) {
+                    f->taken[pc]++;
+                    fr->pc = x->aux;
+                }
+                break;
+            }
+            case IR_RETURN: {
+                i32 ret = VAL(x->lhs);
+                interp->nval = fr->vbase;
+                interp->nmem = fr->mbase;
+                interp->narg = fr->pbase;
+                interp->nframe--;
+                if (interp->nframe) {
+                    frame_t *caller = &interp->frames[interp->nframe - 1];
+                    xinst_t *call   = &caller->fun->code[caller->pc - 1];
+
+                    interp->vals[caller->vbase + call->tar.val] = ret;
+                }
+                break;
+            }
+            case IR_ARG: {
+                interp->args                 = grow(interp->args, &interp->cap_arg, interp->narg + 1, sizeof(i32));
+                interp->args[interp->narg++] = VAL(x->lhs);
+                break;
+            }
+            case IR_PARAM: {
+                if (fr->nparam == fr->narg) {
+                    return fault(interp, "missing argument");
+                }
+                v[x->tar.val] = interp->args[fr->pbase + fr->narg - 1 - fr->nparam++];
+                break;
+            }
+            case IR_CALL: {
+                push_frame(interp, &interp->funs[x->aux], fr->abase, interp->narg - fr->abase);
+                break;
+            }
+            case IR_READ: {
+                if (fscanf(in, "%d", &v[x->tar.val]) != 1) {
+                    return fault(interp, "no integer to read");
+                }
+                break;
+            }
+            case IR_WRITE: {
+                fprintf(out, "%d\n", VAL(x->lhs));
+                break;
+            }
+            default: UNREACHABLE;
+        }
+#undef VAL
+    }
+    interp->cur = NULL;
+    return true;
+}
+
+void interp_stat_print(FILE *file, const interp_t *interp) {
+    u64 kinds[IR_WRITE + 1] = {0}, total = 0;
+    for (u32 i = 0; i < interp->nfun; i++) {
+        xfun_t *f = &interp->funs[i];
+        for (u32 pc = 0; pc < f->ncode; pc++) {
+            kinds[f->code[pc].kind] += f->count[pc];
+            total += f->count[pc];
+        }
+    }
+    fprintf(file, "instrs\t%lu\n", total);
+    for (u32 kind = IR_LABEL; kind <= IR_WRITE; kind++) {
+        fprintf(file, "%s\t%lu\n", IR_NAMES[kind - 1], kinds[kind]);
+    }
+}
+
+static u32 leader_of(const xfun_t *f, u32 pc) {
+    while (!ir_is_leader(f->code[pc].ir)) {
+        pc--;
+    }
+    return f->code[pc].ir->id;
+}
+
+void interp_prof_dump(FILE *file, const interp_t *interp) {
+    fprintf(file, "# block <fun> <leader-id> <count>\n");
+    fprintf(file, "# edge <fun> <from-leader-id> <to-leader-id> <count>\n");
+    for (u32 i = 0; i < interp->nfun; i++) {
+        const xfun_t *f   = &interp->funs[i];
+        const char   *str = f->fun->str;
+        for (u32 pc = 0; pc < f->ncode; pc++) {
+            if (ir_is_leader(f->code[pc].ir)) {
+                fprintf(file, "block %s %u %lu\n", str, f->code[pc].ir->id, f->count[pc]);
+            }
+            if (pc + 1 != f->ncode && !ir_is_leader(f->code[pc + 1].ir)) {
+                continue;
+            }
+            const xinst_t *x    = &f->code[pc];
+            u32            from = leader_of(f, pc);
+            u64            fall = f->count[pc];
+            if (x->kind == IR_GOTO || x->kind == IR_BRANCH) {
+                u64 taken = x->kind == IR_GOTO ? f->count[pc] : f->taken[pc];
+                fprintf(file, "edge %s %u %u %lu\n", str, from, f->code[x->aux].ir->id, taken);
+                fall -= taken;
+            }
+            if (x->kind != IR_GOTO && x->kind != IR_RETURN && pc + 1 != f->ncode) {
+                fprintf(file, "edge %s %u %u %lu\n", str, from, f->code[pc + 1].ir->id, fall);
+            }
+        }
+    }
+}
+
+void interp_annotate(FILE *file, const interp_t *interp) {
+    for (u32 i = 0; i < interp->nfun; i++) {
+        const xfun_t *f = &interp->funs[i];
+        fprintf(file, "FUNCTION %s :\n", f->fun->str);
+        for (u32 pc = 0; pc < f->ncode; pc++) {
+            fprintf(file, "%12lu  ", f->count[pc]);
+            ir_print(file, f->code[pc].ir);
+        }
+        fprintf(file, "\n");
+    }
+}
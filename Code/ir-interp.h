@@ -0,0 +1,41 @@
+#pragma once
+#include "common.h"
+#include "ir.h"
+#include <stdbool.h>
+
+/**
+ * Interpreter for the IR `cfg_destruct` hands to `mips_gen`, with the
+ * meaning `ir_fun_print` gives it: 32-bit wrapping arithmetic, `DEC`
+ * objects in a per-call frame, `ARG`s pushed in reverse order of the
+ * callee's `PARAM`s, and `READ`/`WRITE` on plain integers.
+ *
+ * Every instruction has an execution count. Blocks are the runs the
+ * CFG would build (a `LABEL`, or the instruction after a jump) and are
+ * named by the IR id of their first instruction, so profiles can be
+ * matched against the CFG of a later compile of the same source.
+ */
+
+typedef struct interp_t interp_t;
+
+// NULL, after reporting to stderr, if `prog` calls an unknown function
+interp_t *interp_init(ir_fun_t *prog);
+
+void interp_fini(interp_t *interp);
+
+/**
+ * Runs `main`, giving up after `limit` instructions unless it is 0.
+ * False, after reporting to stderr, on a runtime fault.
+ */
+bool interp_run(interp_t *interp, FILE *in, FILE *out, u64 limit);
+
+void interp_stat_print(FILE *file, const interp_t *interp);
+
+/**
+ * Profile lines, `#` starts a comment:
+ *   block <fun> <leader-id> <count>
+ *   edge <fun> <from-leader-id> <to-leader-id> <count>
+ */
+void interp_prof_dump(FILE *file, const interp_t *interp);
+
+// the IR listing with the execution count of every instruction
+void interp_annotate(FILE *file, const interp_t *interp);
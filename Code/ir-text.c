@@ -0,0 +1,357 @@
+#define _DEFAULT_SOURCE
+#include "ir-text.h"
+#include "symtab.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_TOKEN 8
+
+static const struct {
+    const char *str;
+    op_kind_t   op;
+} OPS[] = {
+    {"+", OP_ADD},
+    {"-", OP_SUB},
+    {"*", OP_MUL},
+    {"/", OP_DIV},
+    {"==", OP_EQ},
+    {"!=", OP_NE},
+    {"<", OP_LT},
+    {"<=", OP_LE},
+    {">", OP_GT},
+    {">=", OP_GE},
+};
+
+// a variable or a label of the function being read, by its text
+typedef struct {
+    const char *key;
+    u64         hash;
+    oprd_t      oprd;
+    IR_t       *label;
+    bool        placed;
+} slot_t;
+
+// open addressing, `cap` a power of two kept at least twice `size`
+typedef struct {
+    slot_t *slots;
+    u32     cap, size;
+} table_t;
+
+struct ir_text_t {
+    char     *buf;
+    char    **names;
+    u32       nname, cap;
+    ir_fun_t *prog;
+};
+
+typedef struct {
+    ir_text_t  *text;
+    const char *fname;
+    u32         lineno, nvar;
+    ir_fun_t   *fun;
+    table_t     vars, labels;
+    bool        bad;
+} reader_t;
+
+static void table_init(table_t *table, u32 cap) {
+    *table = (table_t){zalloc(sizeof(slot_t) * cap), cap, 0};
+}
+
+static slot_t *table_probe(table_t *table, const char *key, u64 hash) {
+    u32 i = hash & (table->cap - 1);
+    while (table->slots[i].key && (table->slots[i].hash != hash || strcmp(table->slots[i].key, key))) {
+        i = (i + 1) & (table->cap - 1);
+    }
+    return &table->slots[i];
+}
+
+// the slot of `key`, zeroed but for the key the first time
+static slot_t *table_find(table_t *table, const char *key) {
+    if ((table->size + 1) * 2 > table->cap) {
+        table_t old = *table;
+        table_init(table, old.cap * 2);
+        for (u32 i = 0; i < old.cap; i++) {
+            if (old.slots[i].key) {
+                *table_probe(table, old.slots[i].key, old.slots[i].hash) = old.slots[i];
+            }
+        }
+        table->size = old.size;
+        zfree(old.slots);
+    }
+    u64     hash = fnv(FNV_INIT, key, strlen(key));
+    slot_t *slot = table_probe(table, key, hash);
+    if (slot->key == NULL) {
+        slot->key  = key;
+        slot->hash = hash;
+        table->size++;
+    }
+    return slot;
+}
+
+static void error(reader_t *rd, const char *what, const char *tok) {
+    if (!rd->bad) {
+        fprintf(stderr, "%s:%u: %s %s\n", rd->fname, rd->lineno, what, tok);
+    }
+    rd->bad = true;
+}
+
+static const char *name_dup(ir_text_t *text, const char *str, u32 len) {
+    if (text->nname == text->cap) {
+        text->cap   = text->cap ? text->cap * 2 : 64;
+        text->names = realloc(text->names, sizeof(char *) * text->cap);
+    }
+    return text->names[text->nname++] = strndup(str, len);
+}
+
+static oprd_t get_var(reader_t *rd, const char *tok) {
+    if (tok == NULL || tok[0] == '#' || tok[0] == '\0') {
+        error(rd, "expected a variable at", tok ? tok : "end of line");
+        return lit_alloc(0);
+    }
+    slot_t *slot = table_find(&rd->vars, tok);
+    if (slot->oprd.kind == OPRD_VAR) {
+        return slot->oprd;
+    }
+    u32 id, lineno;
+    i32 end = 0;
+    if (sscanf(tok, "t_%u_at_%u_%n", &id, &lineno, &end) == 2 && tok[end] == '\0') {
+        slot->oprd = var_alloc(NULL, lineno);
+    } else {
+        // `ir_fun_print` puts the id right after the name
+        const char *name = tok + (strncmp(tok, "n_", 2) || !tok[2] ? 0 : 2);
+        u32         len  = strlen(name);
+        while (len > 1 && isdigit((u8) name[len - 1])) {
+            len--;
+        }
+        slot->oprd = var_alloc(name_dup(rd->text, name, len), 0);
+    }
+    // as `ir_renumber` would give them
+    slot->oprd.id = ++rd->nvar + 1;
+    return slot->oprd;
+}
+
+static oprd_t get_lit(reader_t *rd, const char *tok) {
+    char *end;
+    i64   val = strtoll(tok, &end, 10);
+    if (tok[0] == '\0' || *end != '\0') {
+        error(rd, "bad literal", tok);
+    }
+    return lit_alloc(val);
+}
+
+static oprd_t get_oprd(reader_t *rd, const char *tok) {
+    return tok && tok[0] == '#' ? get_lit(rd, tok + 1) : get_var(rd, tok);
+}
+
+static op_kind_t get_op(reader_t *rd, const char *tok, op_kind_t lo, op_kind_t hi) {
+    for (u32 i = 0; tok && i < ARR_LEN(OPS); i++) {
+        if (!strcmp(OPS[i].str, tok) && OPS[i].op >= lo && OPS[i].op <= hi) {
+            return OPS[i].op;
+        }
+    }
+    error(rd, "bad operator", tok ? tok : "");
+    return lo;
+}
+
+// the label `tok`, made up front when a jump comes before it
+static slot_t *get_label(reader_t *rd, const char *tok) {
+    slot_t *slot = table_find(&rd->labels, tok);
+    if (slot->label == NULL) {
+        slot->label       = zalloc(sizeof(IR_t));
+        slot->label->kind = IR_LABEL;
+        symcpy(slot->label->str, tok);
+    }
+    return slot;
+}
+
+static IR_t *emit(reader_t *rd, ir_kind_t kind) {
+    IR_t *ir = zalloc(sizeof(IR_t));
+    ir->kind = kind;
+    ir_append(&rd->fun->instrs, ir);
+    return ir;
+}
+
+static void fun_end(reader_t *rd) {
+    if (rd->fun == NULL) {
+        return;
+    }
+    for (u32 i = 0; i < rd->labels.cap; i++) {
+        slot_t *slot = &rd->labels.slots[i];
+        if (slot->label && !slot->placed) {
+            error(rd, "undefined label", slot->key);
+            zfree(slot->label);
+        }
+    }
+    u32 id = 0;
+    LIST_ITER(rd->fun->instrs.head, it) {
+        it->id = ++id;
+    }
+    zfree(rd->vars.slots);
+    zfree(rd->labels.slots);
+    rd->fun = NULL;
+}
+
+static void fun_begin(reader_t *rd, ir_fun_t ***tail, const char *name) {
+    fun_end(rd);
+    rd->fun = zalloc(sizeof(ir_fun_t));
+    symcpy(rd->fun->str, name);
+    **tail = rd->fun;
+    *tail  = &rd->fun->next;
+    rd->nvar = 0;
+    table_init(&rd->vars, 64);
+    table_init(&rd->labels, 16);
+}
+
+static void read_line(reader_t *rd, char **tok, u32 ntok) {
+#define IS(I, STR) (ntok > (I) && !strcmp(tok[I], (STR)))
+    IR_t *ir;
+    if (IS(0, "LABEL") && IS(2, ":") && ntok == 3) {
+        slot_t *slot = get_label(rd, tok[1]);
+        if (slot->placed) {
+            error(rd, "label defined twice:", tok[1]);
+            return;
+        }
+        slot->placed = true;
+        ir_append(&rd->fun->instrs, slot->label);
+    } else if (IS(0, "GOTO") && ntok == 2) {
+        emit(rd, IR_GOTO)->jmpto = get_label(rd, tok[1])->label;
+    } else if (IS(0, "IF") && IS(4, "GOTO") && ntok == 6) {
+        ir        = emit(rd, IR_BRANCH);
+        ir->lhs   = get_oprd(rd, tok[1]);
+        ir->op    = get_op(rd, tok[2], OP_LT, OP_NE);
+        ir->rhs   = get_oprd(rd, tok[3]);
+        ir->jmpto = get_label(rd, tok[5])->label;
+    } else if (IS(0, "RETURN") && ntok == 2) {
+        emit(rd, IR_RETURN)->lhs = get_oprd(rd, tok[1]);
+    } else if (IS(0, "DEC") && ntok == 3) {
+        ir      = emit(rd, IR_DEC);
+        ir->tar = get_var(rd, tok[1]);
+        ir->lhs = get_lit(rd, tok[2]);
+    } else if (IS(0, "ARG") && ntok == 2) {
+        emit(rd, IR_ARG)->lhs = get_oprd(rd, tok[1]);
+    } else if (IS(0, "PARAM") && ntok == 2) {
+        emit(rd, IR_PARAM)->tar = get_var(rd, tok[1]);
+    } else if (IS(0, "READ") && ntok == 2) {
+        emit(rd, IR_READ)->tar = get_var(rd, tok[1]);
+    } else if (IS(0, "WRITE") && ntok == 2) {
+        // its value is never printed, nor used
+        ir         = emit(rd, IR_WRITE);
+        ir->tar    = var_alloc(NULL, rd->lineno);
+        ir->tar.id = ++rd->nvar + 1;
+        ir->lhs    = get_oprd(rd, tok[1]);
+    } else if (IS(1, ":=") && tok[0][0] == '*' && ntok == 3) {
+        ir      = emit(rd, IR_STORE);
+        ir->tar = get_var(rd, tok[0] + 1);
+        ir->lhs = get_oprd(rd, tok[2]);
+    } else if (IS(1, ":=") && IS(2, "CALL") && ntok == 4) {
+        ir      = emit(rd, IR_CALL);
+        ir->tar = get_var(rd, tok[0]);
+        symcpy(ir->str, tok[3]);
+    } else if (IS(1, ":=") && ntok == 5) {
+        ir      = emit(rd, IR_BINARY);
+        ir->tar = get_var(rd, tok[0]);
+        ir->lhs = get_oprd(rd, tok[2]);
+        ir->op  = get_op(rd, tok[3], OP_ADD, OP_NE);
+        ir->rhs = get_oprd(rd, tok[4]);
+    } else if (IS(1, ":=") && ntok == 3) {
+        char c  = tok[2][0];
+        ir      = emit(rd, c == '&' ? IR_DREF : c == '*' ? IR_LOAD : IR_ASSIGN);
+        ir->tar = get_var(rd, tok[0]);
+        ir->lhs = ir->kind == IR_ASSIGN ? get_oprd(rd, tok[2]) : get_var(rd, tok[2] + 1);
+    } else {
+        error(rd, "cannot parse", tok[0]);
+    }
+#undef IS
+}
+
+static char *read_all(const char *fname, u32 *len) {
+    char *buf  = NULL;
+    u32   size = 0, cap = 0;
+    FOPEN(fname, file, "r") {
+        for (u32 n = 1; n > 0; size += n) {
+            if (size + 1 >= cap) {
+                cap = cap ? cap * 2 : BUFSIZ;
+                buf = realloc(buf, cap);
+            }
+            n = fread(buf + size, 1, cap - size - 1, file);
+        }
+        buf[size] = '\0';
+    }
+    *len = size;
+    return buf;
+}
+
+ir_text_t *ir_text_open(const char *fname) {
+    u32   len;
+    char *buf = read_all(fname, &len);
+    if (buf == NULL) {
+        perror(fname);
+        return NULL;
+    }
+    ir_text_t *text = zalloc(sizeof(ir_text_t));
+    text->buf       = buf;
+    reader_t   rd   = {.text = text, .fname = fname};
+    ir_fun_t **tail = &text->prog;
+
+    // every line is cut into words in place, names point into `buf`
+    for (char *line = buf, *next; line < buf + len && !rd.bad; line = next) {
+        next = strchr(line, '\n');
+        next = next ? next : buf + len;
+        *next++ = '\0';
+        rd.lineno++;
+
+        char *tok[MAX_TOKEN + 1];
+        u32   ntok = 0;
+        for (char *p = line; *p && ntok <= MAX_TOKEN;) {
+            while (isspace((u8) *p)) {
+                *p++ = '\0';
+            }
+            if (*p) {
+                tok[ntok++] = p;
+            }
+            while (*p && !isspace((u8) *p)) {
+                p++;
+            }
+        }
+        // `=>` marks an instruction in debug dumps
+        u32 skip = ntok > 0 && !strcmp(tok[0], "=>");
+        if (ntok == skip) {
+            continue;
+        } else if (ntok > MAX_TOKEN) {
+            error(&rd, "cannot parse", tok[0]);
+        } else if (!strcmp(tok[skip], "FUNCTION") && ntok == skip + 3 && !strcmp(tok[skip + 2], ":")) {
+            fun_begin(&rd, &tail, tok[skip + 1]);
+        } else if (rd.fun == NULL) {
+            error(&rd, "outside of a function:", tok[skip]);
+        } else {
+            read_line(&rd, tok + skip, ntok - skip);
+        }
+    }
+    fun_end(&rd);
+    if (rd.bad) {
+        LIST_ITER(text->prog, fun) {
+            ir_list_free(&fun->instrs);
+        }
+        ir_fun_free(text->prog);
+        text->prog = NULL;
+        ir_text_close(text);
+        return NULL;
+    }
+    return text;
+}
+
+ir_fun_t *ir_text_prog(ir_text_t *text) {
+    ir_fun_t *prog = text->prog;
+    text->prog     = NULL;
+    return prog;
+}
+
+void ir_text_close(ir_text_t *text) {
+    for (u32 i = 0; i < text->nname; i++) {
+        free(text->names[i]);
+    }
+    free(text->names);
+    free(text->buf);
+    zfree(text);
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include "common.h"
+#include "ir.h"
+
+/**
+ * Reads back what `ir_fun_print` writes, so that the middle end can be run
+ * on an IR dump without the front end. Variables are told apart by their
+ * text: `n_x12` is `x`, `t_5_at_3_` a temporary of line 3, any other word a
+ * variable of that name. Ids are given afresh, in order of appearance.
+ */
+
+typedef struct ir_text_t ir_text_t;
+
+// parses all of `fname`, NULL after reporting to stderr where it is malformed
+ir_text_t *ir_text_open(const char *fname);
+
+// hands over the functions read, in file order
+ir_fun_t *ir_text_prog(ir_text_t *text);
+
+// variable names of the functions read belong to `text`, close it after them
+void ir_text_close(ir_text_t *text);
@@ -1,6 +1,7 @@
 #include "ir.h"
 #include "ast.h"
 #include "common.h"
+#include "map.h"
 #include "visitor.h"
 #include "symtab.h"
 #include <stdarg.h>
@@ -27,13 +28,92 @@ void IR_visitor_dispatch(const struct IR_visitor visitor, IR_t *node, void *p) {
     }
 }
 
+static u32  nvar = 1, ninstr = 0;
+static char scope[MAX_SYM_LEN]; // labels are named after their function
+
+void ir_reset_ids() {
+    nvar   = 1;
+    ninstr = 0;
+}
+
+static void label_name(IR_t *label) {
+    // `scope` cut so that the id always fits
+    snprintf(label->str, sizeof(label->str), "%.47s_label%u", scope, label->id);
+}
+
+static i32 id_cmp(const void *lhs, const void *rhs) {
+    uptr l = *(const uptr *) lhs, r = *(const uptr *) rhs;
+    return l < r ? -1 : l > r;
+}
+
+u32 ir_ids_uniq(uptr *ids, u32 n) {
+    qsort(ids, n, sizeof(uptr), id_cmp);
+    u32 m = 0;
+    for (u32 i = 0; i < n; i++) {
+        if (m == 0 || ids[m - 1] != ids[i]) {
+            ids[m++] = ids[i];
+        }
+    }
+    return m;
+}
+
+u32 ir_ids_rank(const uptr *ids, u32 n, uptr id) {
+    const uptr *pos = bsearch(&id, ids, n, sizeof(uptr), id_cmp);
+    ASSERT(pos != NULL, "id %lu not collected", id);
+    return pos - ids + 1;
+}
+
+#define OPRD_VARS(IR, F) \
+    F((IR)->tar)         \
+    F((IR)->lhs)         \
+    F((IR)->rhs)
+
+void ir_renumber(ir_fun_t *fun) {
+    u32 ninstr_ = 0, nvar_ = 0;
+    LIST_ITER(fun->instrs.head, it) {
+        ninstr_++;
+    }
+    uptr *instrs = zalloc(sizeof(uptr) * (ninstr_ + 1));
+    uptr *vars   = zalloc(sizeof(uptr) * (ninstr_ * 3 + 1));
+
+    ninstr_ = 0;
+    LIST_ITER(fun->instrs.head, it) {
+        instrs[ninstr_++] = it->id;
+#define COLLECT(OPRD)              \
+    if ((OPRD).kind == OPRD_VAR) { \
+        vars[nvar_++] = (OPRD).id; \
+    }
+        OPRD_VARS(it, COLLECT)
+    }
+    ninstr_ = ir_ids_uniq(instrs, ninstr_);
+    nvar_   = ir_ids_uniq(vars, nvar_);
+
+    symcpy(scope, fun->str);
+    LIST_ITER(fun->instrs.head, it) {
+        it->id = ir_ids_rank(instrs, ninstr_, it->id);
+#define RENAME(OPRD)                                         \
+    if ((OPRD).kind == OPRD_VAR) {                           \
+        (OPRD).id = ir_ids_rank(vars, nvar_, (OPRD).id) + 1; \
+    }
+        OPRD_VARS(it, RENAME)
+        if (it->kind == IR_LABEL) {
+            label_name(it);
+        }
+    }
+    zfree(instrs);
+    zfree(vars);
+
+    // the variables `sem` gave the functions still to come keep their ids
+    nvar   = nvar_ + 1 > nvar ? nvar_ + 1 : nvar;
+    ninstr = ninstr_;
+}
+
 oprd_t var_alloc(const char *name, u32 lineno) {
-    static u32 cnt = 1;
     return (oprd_t){
         .kind   = OPRD_VAR,
         .name   = name,
         .lineno = lineno,
-        .val    = ++cnt};
+        .val    = ++nvar};
 }
 
 char *oprd_to_str(oprd_t oprd) {
@@ -70,6 +150,8 @@ void ir_fun_free(ir_fun_t *fun) {
         return;
     }
     ir_fun_free(fun->next);
+    free(fun->ir_text);
+    free(fun->asm_text);
     zfree(fun);
 }
 
@@ -79,31 +161,32 @@ oprd_t lit_alloc(i64 value) {
         .val  = value};
 }
 
-void chain_merge(chain_t **into, chain_t *rhs) {
-    LIST_APPEND(*into, rhs);
+void chain_merge(chains_t *into, chains_t rhs) {
+    if (rhs.head == NULL) {
+        return;
+    }
+    if (into->head == NULL) {
+        *into = rhs;
+        return;
+    }
+    into->tail->next = rhs.head;
+    into->tail       = rhs.tail;
 }
 
-void chain_insert(chain_t **chain, IR_t *ir) {
+void chain_insert(chains_t *chain, IR_t *ir) {
     chain_t *node = zalloc(sizeof(chain_t));
 
     *node = (chain_t){.ir = ir};
-    chain_merge(chain, node);
-}
-
-static void chain_free(chain_t *chain) {
-    if (!chain) {
-        return;
-    }
-    chain_free(chain->next);
-    zfree(chain);
+    chain_merge(chain, (chains_t){node, node});
 }
 
-void chain_resolve(chain_t **chain, IR_t *ir) {
-    LIST_ITER(*chain, it) {
+void chain_resolve(chains_t *chain, IR_t *ir) {
+    for (chain_t *it = chain->head, *next; it; it = next) {
+        next          = it->next;
         it->ir->jmpto = ir;
+        zfree(it);
     }
-    chain_free(*chain);
-    *chain = NULL;
+    *chain = (chains_t){0};
 }
 
 #define RET_TYPE va_list
@@ -123,14 +206,12 @@ void ir_list_free(ir_list *list) {
 }
 
 IR_t *ir_alloc(ir_kind_t kind, ...) {
-    static u32 cnt = 0;
-
     va_list ap;
     va_start(ap, kind);
 
     IR_t *ir = zalloc(sizeof(IR_t));
     ir->kind = kind;
-    ir->id   = ++cnt;
+    ir->id   = ++ninstr;
     VISITOR_DISPATCH(IR, new, ir, ap);
 
     va_end(ap);
@@ -144,6 +225,74 @@ IR_t *ir_dup(IR_t *ir) {
     return ptr;
 }
 
+IR_t *ir_copy(IR_t *ir) {
+    IR_t *ptr = ir_dup(ir);
+
+    ptr->id   = ++ninstr;
+    ptr->prev = ptr->next = NULL;
+    return ptr;
+}
+
+ir_list ir_clone(const ir_list *list) {
+    if (list->head == NULL) {
+        return (ir_list){0};
+    }
+    // only temporaries defined here are its own, the rest come from before
+    set_t temps;
+    u32   lo = UINT32_MAX, hi = 0;
+    uptr  tlo = UINTPTR_MAX, thi = 0;
+    set_init(&temps);
+    LIST_ITER(list->head, it) {
+        lo = it->id < lo ? it->id : lo;
+        hi = it->id > hi ? it->id : hi;
+        if (it->kind != IR_STORE && it->tar.kind == OPRD_VAR && it->tar.name == NULL) {
+            set_insert(&temps, (void *) it->tar.id);
+            tlo = it->tar.id < tlo ? it->tar.id : tlo;
+            thi = it->tar.id > thi ? it->tar.id : thi;
+        }
+    }
+
+    // a list just generated holds a short run of ids, so the new ones are
+    // the old ones moved past the last ids given out; the ids between may
+    // be some other list's, so instructions are matched up by address
+    map_t copies;
+    map_init(&copies);
+    LIST_ITER(list->head, it) {
+        IR_t *copy = ir_dup(it);
+        copy->id   = ninstr + (it->id - lo) + 1;
+#define RENAME_TEMP(OPRD)                                                     \
+    if ((OPRD).kind == OPRD_VAR && set_contains(&temps, (void *) (OPRD).id)) { \
+        (OPRD).id = nvar + ((OPRD).id - tlo) + 1;                             \
+    }
+        OPRD_VARS(copy, RENAME_TEMP)
+        if (copy->kind == IR_LABEL) {
+            label_name(copy);
+        }
+        map_insert(&copies, it, copy);
+    }
+
+    ir_list result = {0};
+    LIST_ITER(list->head, it) {
+        IR_t *copy = map_find(&copies, it);
+        IR_t *to   = copy->jmpto ? map_find(&copies, copy->jmpto) : NULL;
+        if (to != NULL) {
+            copy->jmpto = to;
+        }
+        ir_append(&result, copy);
+    }
+    LIST_ITER(list->tru.head, it) {
+        chain_insert(&result.tru, map_find(&copies, it->ir));
+    }
+    LIST_ITER(list->fls.head, it) {
+        chain_insert(&result.fls, map_find(&copies, it->ir));
+    }
+    ninstr += hi - lo + 1;
+    nvar += tlo <= thi ? thi - tlo + 1 : 0;
+    map_fini(&copies);
+    set_fini(&temps);
+    return result;
+}
+
 void ir_append(ir_list *list, IR_t *ir) {
     ir_validate(list);
     if (list->size == 0) {
@@ -205,16 +354,20 @@ ir_list ir_split(ir_list *list, IR_t *it) {
     ASSERT(it != NULL, "split NULL it");
 
     if (list->head != it) {
+        // counts the front, which `cfg_build` keeps short
+        u32 size = 0;
+        for (IR_t *p = list->head; p != it; p = p->next) {
+            size++;
+        }
         front = (ir_list){
-            .head = it,
-            .tail = list->tail,
-            .size = LIST_LENGTH(it)};
-        list->tail = it->prev;
-        list->size -= front.size;
+            .head = list->head,
+            .tail = it->prev,
+            .size = size};
+        list->head = it;
+        list->size -= size;
 
         it->prev->next = NULL;
         it->prev       = NULL;
-        swap(front, *list);
     }
     ir_validate(list);
     ir_validate(&front);
@@ -265,8 +418,36 @@ void ir_check(ir_list *list) {
     }
 }
 
+bool ir_defines(const IR_t *ir, oprd_t oprd) {
+    return oprd.kind == OPRD_VAR && ir->kind != IR_STORE && ir->tar.kind == OPRD_VAR && ir->tar.id == oprd.id;
+}
+
+op_kind_t op_negate(op_kind_t op) {
+    switch (op) {
+        case OP_LT: return OP_GE;
+        case OP_LE: return OP_GT;
+        case OP_GT: return OP_LE;
+        case OP_GE: return OP_LT;
+        case OP_EQ: return OP_NE;
+        case OP_NE: return OP_EQ;
+        default: UNREACHABLE;
+    }
+}
+
+bool ir_is_leader(const IR_t *ir) {
+    if (ir->prev == NULL || ir->kind == IR_LABEL) {
+        return true;
+    }
+    switch (ir->prev->kind) {
+        case IR_GOTO:
+        case IR_BRANCH:
+        case IR_RETURN: return true;
+        default: return false;
+    }
+}
+
 VISIT(IR_LABEL) {
-    snprintf(node->str, sizeof(node->str), "label%u", node->id);
+    label_name(node);
 }
 
 VISIT(IR_ASSIGN) {
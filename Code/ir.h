@@ -53,6 +53,7 @@ typedef struct IR_fun_t ir_fun_t;
 typedef struct IR_t     IR_t;
 typedef struct oprd_t   oprd_t;
 typedef struct chain_t  chain_t;
+typedef struct chains_t chains_t;
 
 typedef enum {
     OPRD_LIT,
@@ -88,9 +89,14 @@ struct chain_t {
     chain_t *next;
 };
 
+// a backpatch list, its tail kept for merging in O(1)
+struct chains_t {
+    chain_t *head, *tail;
+};
+
 struct IR_list {
     IR_t    *head, *tail;
-    chain_t *fls, *tru;
+    chains_t fls, tru;
     u32      size;
 };
 
@@ -99,6 +105,12 @@ struct IR_fun_t {
     ir_list   instrs;
     ir_fun_t *next;
     u32       sf_size;
+
+    // `-cache`: a cached function keeps only its printed IR and code template
+    bool  cached;
+    u64   key;
+    u32   line;
+    char *ir_text, *asm_text;
 };
 
 void ir_append(ir_list *list, IR_t *ir);
@@ -128,6 +140,9 @@ IR(IR_EXTEND);
 
 void ir_fun_print(FILE *file, ir_fun_t *fun);
 
+// `fun` alone, not the functions after it
+void ir_fun_print_one(FILE *file, ir_fun_t *fun);
+
 void ir_list_free(ir_list *list);
 
 void ir_print(FILE *file, IR_t *ir);
@@ -136,12 +151,41 @@ IR_t *ir_alloc(ir_kind_t kind, ...);
 
 IR_t *ir_dup(IR_t *ir);
 
+// `ir` under an id of its own, to sit beside it
+IR_t *ir_copy(IR_t *ir);
+
+// `list` again, backpatch lists included, with labels and temporaries of its
+// own numbered as generating it a second time would
+ir_list ir_clone(const ir_list *list);
+
 void ir_check(ir_list *list);
 
+// starts a block as `cfg_build` splits them
+bool ir_is_leader(const IR_t *ir);
+
+// whether `ir` assigns the variable `oprd`
+bool ir_defines(const IR_t *ir, oprd_t oprd);
+
+// the comparison that holds when `op` does not
+op_kind_t op_negate(op_kind_t op);
+
 i32 oprd_cmp(const void *lhs, const void *rhs);
 
 oprd_t var_alloc(const char *name, u32 lineno);
 
+// restarts variable and instruction ids, for the next translation unit
+void ir_reset_ids();
+
+// gives `fun` ids and labels of its own, keeping their order, so that its code
+// does not depend on the functions around it; later ids continue from there
+void ir_renumber(ir_fun_t *fun);
+
+// sorts `ids` and drops repeats, returns how many are left
+u32 ir_ids_uniq(uptr *ids, u32 n);
+
+// 1 + the index of `id` in `ids` as left by `ir_ids_uniq`
+u32 ir_ids_rank(const uptr *ids, u32 n, uptr id);
+
 oprd_t lit_alloc(i64 value);
 
 void ir_fun_free(ir_fun_t *fun);
@@ -150,8 +194,12 @@ char *oprd_to_str(oprd_t oprd);
 
 ir_list ast_gen(AST_t *node, oprd_t tar);
 
-void chain_insert(chain_t **chain, IR_t *ir);
+// `-loop`: how a while statement tests its condition, NULL for the usual way,
+// false after reporting an unknown one
+bool loop_select(const char *mode);
+
+void chain_insert(chains_t *chain, IR_t *ir);
 
-void chain_resolve(chain_t **chain, IR_t *ir);
+void chain_resolve(chains_t *chain, IR_t *ir);
 
-void chain_merge(chain_t **into, chain_t *rhs);
\ No newline at end of file
+void chain_merge(chains_t *into, chains_t rhs);
\ No newline at end of file
@@ -21,12 +21,20 @@ void ir_print(FILE *file, IR_t *ir) {
     ir_print_(ir);
 }
 
-void ir_fun_print(FILE *file, ir_fun_t *fun) {
+void ir_fun_print_one(FILE *file, ir_fun_t *fun) {
     fout = file;
+    if (fun->cached) {
+        fputs(fun->ir_text, fout);
+        return;
+    }
+    fprintf(fout, "FUNCTION %s :\n", fun->str);
+    LIST_FOREACH(fun->instrs.head, ir_print_);
+    fprintf(fout, "\n");
+}
+
+void ir_fun_print(FILE *file, ir_fun_t *fun) {
     LIST_ITER(fun, it) {
-        fprintf(fout, "FUNCTION %s :\n", it->str);
-        LIST_FOREACH(it->instrs.head, ir_print_);
-        fprintf(fout, "\n");
+        ir_fun_print_one(file, it);
     }
 }
 
@@ -46,6 +54,13 @@ VISIT(IR_BINARY) {
         case OP_SUB: op_str = "-"; break;
         case OP_MUL: op_str = "*"; break;
         case OP_DIV: op_str = "/"; break;
+        // -setcc
+        case OP_LT: op_str = "<"; break;
+        case OP_LE: op_str = "<="; break;
+        case OP_GT: op_str = ">"; break;
+        case OP_GE: op_str = ">="; break;
+        case OP_EQ: op_str = "=="; break;
+        case OP_NE: op_str = "!="; break;
         default: UNREACHABLE;
     }
 
@@ -12,6 +12,7 @@ VISITOR_DEF(AST, lexpr, RET_TYPE);
 extern oprd_t oprd_tar();
 extern void   oprd_push(oprd_t oprd);
 extern void   oprd_pop();
+extern oprd_t value_gen(AST_t *node, oprd_t tar, ir_list *list);
 
 ir_list lexpr_gen(AST_t *node, oprd_t tar) {
     oprd_push(tar);
@@ -44,9 +45,9 @@ VISIT(EXPR_DOT) {
 }
 
 VISIT(EXPR_ARR) {
-    oprd_t  pos     = var_alloc(NULL, node->super.fst_l);
-    ir_list arr     = lexpr_gen(node->arr, pos);
-    type_t  arr_typ = {0};
+    oprd_t        pos     = var_alloc(NULL, node->super.fst_l);
+    ir_list       arr     = lexpr_gen(node->arr, pos);
+    const type_t *arr_typ = NULL;
     switch (node->arr->kind) {
         case EXPR_IDEN: {
             INSTANCE_OF(node->arr, EXPR_IDEN) {
@@ -66,8 +67,9 @@ VISIT(EXPR_ARR) {
     u32 cnt = 0;
     LIST_ITER(node->ind, it) {
         oprd_t  ind_var  = var_alloc(NULL, node->super.fst_l);
-        ir_list ind      = ast_gen(it, ind_var);
-        oprd_t  acc_size = lit_alloc(arr_typ.acc[cnt++]);
+        ir_list ind      = {0};
+        ind_var          = value_gen(it, ind_var, &ind);
+        oprd_t  acc_size = lit_alloc(arr_typ->acc[cnt++]);
         oprd_t  tmp      = var_alloc(NULL, 0);
         ir_append(&ind,
                   ir_alloc(IR_BINARY,
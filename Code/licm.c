@@ -4,6 +4,7 @@
 #include "cfg.h"
 #include "ir.h"
 #include "map.h"
+#include "profile.h"
 #include <string.h>
 
 typedef struct loop_t {
@@ -102,7 +103,8 @@ void do_licm(cfg_t *cfg) {
     LIST_ITER(cfg->blocks, blk) {
         dom_data_t *pd = dom_df.data_at(dom_df.data_out, blk->id);
         succ_iter(blk, e) {
-            if (set_contains(&pd->dom, e->to)) {
+            // loops that never ran in the profile are not worth the work
+            if (set_contains(&pd->dom, e->to) && block_count(cfg, e->to) != 0) {
                 loop_t loop;
                 loop_init(&loop, e->to);
                 memset(vis, 0, sizeof(bool) * cfg->nnode);
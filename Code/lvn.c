@@ -28,7 +28,6 @@ static map_t cvar_map;
 static map_t holding_map;
 
 static void lvn_init() {
-    memset(&hashtab, 0, sizeof(hashtab));
     valcnt = 1;
     map_init(&cvar_map);
     map_init(&holding_map);
@@ -48,6 +47,7 @@ static void lvn_fini() {
     }
     map_fini(&cvar_map);
     map_fini(&holding_map);
+    hash_fini(&hashtab);
 }
 
 void do_lvn(cfg_t *cfg) {
@@ -74,11 +74,16 @@ static void cvar_insert(val_t val, oprd_t var) {
         .next = NULL};
 }
 
+// literals share a value with variables, and `id` with `val`
+static bool same_var(oprd_t oprd, oprd_t var) {
+    return oprd.kind == OPRD_VAR && oprd.id == var.id;
+}
+
 static void cvar_remove(val_t val, oprd_t var) {
     cvar_t *cp   = NULL;
     cvar_t *cvar = map_find(&cvar_map, (void *) val);
 
-    if (cvar && cvar->var.id == var.id) {
+    if (cvar && same_var(cvar->var, var)) {
         cp = cvar;
         if (cvar->next) {
             map_insert(&cvar_map, (void *) val, cvar->next);
@@ -88,7 +93,7 @@ static void cvar_remove(val_t val, oprd_t var) {
         goto done;
     }
     LIST_ITER(cvar, it) {
-        if (it->next && it->next->var.id == var.id) {
+        if (it->next && same_var(it->next->var, var)) {
             cp       = it->next;
             it->next = cp->next;
             goto done;
@@ -101,8 +106,7 @@ done:
 
 static val_t unrtab_insert(oprd_t oprd) {
     const char *str = oprd_to_str(oprd);
-    hashent_t  *ent = hash_lookup(&hashtab, str);
-    symcpy(ent->str, str);
+    hashent_t  *ent = hash_insert(&hashtab, str);
     ent->ptr = (void *) valcnt;
     return valcnt++;
 }
@@ -116,6 +120,8 @@ static bool abel(op_kind_t op) {
     switch (op) {
         case OP_ADD:
         case OP_MUL:
+        case OP_EQ:
+        case OP_NE:
             return true;
         default:
             return false;
@@ -129,8 +135,7 @@ static val_t bintab_insert(op_kind_t op, val_t lhs, val_t rhs) {
     }
     static char str[BUFSIZ];
     snprintf(str, sizeof(str), "%lu %u %lu", lhs, op, rhs);
-    hashent_t *ent = hash_lookup(&hashtab, str);
-    symcpy(ent->str, str);
+    hashent_t *ent = hash_insert(&hashtab, str);
     ent->ptr = (void *) valcnt;
     return valcnt++;
 }
@@ -254,7 +259,8 @@ VISIT(IR_READ) {
 VISIT(IR_WRITE) {
     val_t expr = oprd_to_val(node->lhs);
     oprd_rewrite(&node->lhs, expr);
-    oprd_holds(node->tar, expr);
+    // nothing stores into `tar`, so it cannot stand for `lhs`
+    oprd_holds(node->tar, unrtab_insert(node->tar));
 }
 
 VISIT(IR_ARG) {
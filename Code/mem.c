@@ -0,0 +1,265 @@
+#include "alias.h"
+#include "cfg.h"
+#include "common.h"
+#include "ir.h"
+#include "map.h"
+
+/**
+ * Loads and stores within a block. A load from where a store or another
+ * load left a value in some variable takes that variable instead, and a
+ * store overwritten before anything reads it goes, as does one into an
+ * object no load and no call ever sees. Within the block an address is a
+ * constant offset from some value there, and past that `alias.c` tells
+ * which may meet.
+ */
+
+#define MAX_AVAIL 64
+
+// `off` past whatever `tok` stands for
+typedef struct {
+    u32 tok;
+    i64 off;
+} addr_t;
+
+// memory at `at`, somewhere in `loc`, holds `val`
+typedef struct {
+    addr_t at;
+    loc_t  loc;
+    oprd_t val;
+} avail_t;
+
+static alias_t pa;
+// the objects some load reads
+static set_t loaded;
+static bool  any_loaded;
+
+// var id => its address in the block so far
+static map_t    addrs;
+static addr_t  *pool;
+static avail_t *acc;
+static u32      npool, ntok;
+
+static avail_t avail[MAX_AVAIL];
+static u32     navail;
+
+static void loads(cfg_t *cfg) {
+    LIST_ITER(cfg->blocks, blk) {
+        LIST_ITER(blk->instrs.head, ir) {
+            loc_t loc = ir->kind == IR_LOAD ? alias_loc(&pa, ir->lhs) : (loc_t){.ext = true};
+            if (loc.ext) {
+                continue;
+            }
+            if (loc.base == 0) {
+                any_loaded = true;
+            } else {
+                set_insert(&loaded, (void *) loc.base);
+            }
+        }
+    }
+}
+
+// an object of this activation only, which nothing reads after it returns
+static bool local(loc_t loc) {
+    return !alias_escapes(&pa, loc);
+}
+
+static bool never_loaded(loc_t loc) {
+    return local(loc) && !any_loaded && !set_contains(&loaded, (void *) loc.base);
+}
+
+static bool same_addr(const avail_t *lhs, const avail_t *rhs) {
+    if (lhs->at.tok == rhs->at.tok) {
+        return lhs->at.off == rhs->at.off;
+    }
+    return alias_query(lhs->loc, rhs->loc) == ALIAS_MUST;
+}
+
+static bool may_alias(const avail_t *lhs, const avail_t *rhs) {
+    if (lhs->at.tok == rhs->at.tok) {
+        return lhs->at.off == rhs->at.off;
+    }
+    return alias_query(lhs->loc, rhs->loc) != ALIAS_NO;
+}
+
+static addr_t addr_of(oprd_t oprd) {
+    addr_t *addr = oprd.kind == OPRD_VAR ? map_find(&addrs, (void *) oprd.id) : NULL;
+    if (addr != NULL) {
+        return *addr;
+    }
+    addr  = &pool[npool++];
+    *addr = (addr_t){.tok = ++ntok};
+    if (oprd.kind == OPRD_VAR) {
+        map_insert(&addrs, (void *) oprd.id, addr);
+    }
+    return *addr;
+}
+
+static void addr_def(oprd_t tar, addr_t addr) {
+    pool[npool] = addr;
+    map_insert(&addrs, (void *) tar.id, &pool[npool++]);
+}
+
+// what `tar` of `ir` points to, as an offset from some other address
+static addr_t addr_transfer(IR_t *ir) {
+    oprd_t lhs = ir->lhs, rhs = ir->rhs;
+    switch (ir->kind) {
+        case IR_DREF:
+        case IR_ASSIGN: return addr_of(lhs);
+        case IR_BINARY: {
+            addr_t addr;
+            if (ir->op == OP_ADD && lhs.kind == OPRD_LIT) {
+                swap(lhs, rhs);
+            }
+            if (rhs.kind == OPRD_LIT && (ir->op == OP_ADD || ir->op == OP_SUB)) {
+                addr = addr_of(lhs);
+                addr.off += ir->op == OP_ADD ? rhs.val : -rhs.val;
+                return addr;
+            }
+            break;
+        }
+        default: break;
+    }
+    return (addr_t){.tok = ++ntok};
+}
+
+static void avail_remove(bool (*dead)(const avail_t *, const void *), const void *arg) {
+    u32 n = 0;
+    for (u32 i = 0; i < navail; i++) {
+        if (!dead(&avail[i], arg)) {
+            avail[n++] = avail[i];
+        }
+    }
+    navail = n;
+}
+
+static bool holds(const avail_t *av, const void *ir) {
+    return ir_defines(ir, av->val);
+}
+
+static bool stored_over(const avail_t *av, const void *st) {
+    return may_alias(av, st);
+}
+
+static bool called(const avail_t *av, const void *arg) {
+    return alias_escapes(&pa, av->loc);
+}
+
+static void avail_add(avail_t av) {
+    if (navail < MAX_AVAIL) {
+        avail[navail++] = av;
+    }
+}
+
+// forwards loads, and notes in `acc` where each load and store goes
+static void forward(block_t *blk) {
+    u32 i = 0;
+    LIST_ITER(blk->instrs.head, ir) {
+        switch (ir->kind) {
+            case IR_LOAD: {
+                avail_t *ld = &acc[i];
+                *ld         = (avail_t){addr_of(ir->lhs), alias_loc(&pa, ir->lhs), ir->tar};
+                for (u32 j = 0; j < navail; j++) {
+                    if (same_addr(&avail[j], ld)) {
+                        ir->kind = IR_ASSIGN;
+                        ir->lhs = ld->val = avail[j].val;
+                        break;
+                    }
+                }
+                avail_remove(holds, ir);
+                avail_add(*ld);
+                break;
+            }
+            case IR_STORE: {
+                avail_t *st = &acc[i];
+                *st         = (avail_t){addr_of(ir->tar), alias_loc(&pa, ir->tar), ir->lhs};
+                avail_remove(stored_over, st);
+                avail_add(*st);
+                break;
+            }
+            case IR_CALL:
+                avail_remove(called, NULL);
+                avail_remove(holds, ir);
+                break;
+            default: avail_remove(holds, ir); break;
+        }
+        if (ir->kind != IR_STORE && ir->tar.kind == OPRD_VAR) {
+            addr_def(ir->tar, addr_transfer(ir));
+        }
+        i++;
+    }
+}
+
+// drops the stores nothing reads before they are overwritten, or before
+// the function returns if they go into an object of its own
+static void eliminate(block_t *blk) {
+    avail_t pending[MAX_AVAIL];
+    u32     npending = 0;
+    u32     i        = blk->instrs.size;
+    IR_t   *last     = blk->instrs.tail;
+    bool    returns  = last != NULL && last->kind == IR_RETURN;
+    LIST_REV_ITER(blk->instrs.tail, ir) {
+        avail_t *it = &acc[--i];
+        u32      n  = 0;
+        switch (ir->kind) {
+            case IR_STORE: {
+                bool dead = never_loaded(it->loc) || (returns && local(it->loc));
+                for (u32 j = 0; j < npending && !dead; j++) {
+                    dead = same_addr(&pending[j], it);
+                }
+                ir->mark = dead;
+                if (!dead && npending < MAX_AVAIL) {
+                    pending[npending++] = *it;
+                }
+                break;
+            }
+            case IR_LOAD: {
+                for (u32 j = 0; j < npending; j++) {
+                    if (!may_alias(&pending[j], it)) {
+                        pending[n++] = pending[j];
+                    }
+                }
+                npending = n;
+                returns &= it->loc.ext;
+                break;
+            }
+            case IR_CALL: {
+                for (u32 j = 0; j < npending; j++) {
+                    if (!alias_escapes(&pa, pending[j].loc)) {
+                        pending[n++] = pending[j];
+                    }
+                }
+                npending = n;
+                break;
+            }
+            default: break;
+        }
+    }
+    ir_remove_mark(&blk->instrs);
+}
+
+void do_mem(cfg_t *cfg) {
+    alias_init(&pa, cfg);
+    set_init(&loaded);
+    any_loaded = false;
+    // forwarding takes loads away, and with them what keeps stores alive
+    for (u32 round = 0; round < 2; round++) {
+        if (round == 1) {
+            loads(cfg);
+        }
+        LIST_ITER(cfg->blocks, blk) {
+            pool  = zalloc(sizeof(addr_t) * (3 * blk->instrs.size + 1));
+            acc   = zalloc(sizeof(avail_t) * (blk->instrs.size + 1));
+            npool = ntok = navail = 0;
+            map_init(&addrs);
+            forward(blk);
+            if (round == 1) {
+                eliminate(blk);
+            }
+            map_fini(&addrs);
+            zfree(pool);
+            zfree(acc);
+        }
+    }
+    alias_fini(&pa);
+    set_fini(&loaded);
+}
@@ -0,0 +1,434 @@
+#include "mips-asm.h"
+#include <ctype.h>
+#include <string.h>
+
+#define MINST_NAME(KIND, NAME, FMT) NAME,
+#define MINST_FMT(KIND, NAME, FMT) FMT,
+
+const char  *MINST_NAMES[] = {"", MINSTS(MINST_NAME)};
+const mfmt_t MINST_FMTS[]  = {MF_NONE, MINSTS(MINST_FMT)};
+
+static const char *REG_STRS[] = {REGS(STRING_LIST)};
+
+#define MAX_LINE 4096
+
+typedef struct {
+    mips_prog *prog;
+    u32        cap_text, cap_data, cap_label;
+    char (*refs)[MAX_SYM_LEN]; // label operand of text[i], resolved at the end
+    u32   addr;                // next free .text address
+    bool  in_text;
+    u32   lineno;
+} parser_t;
+
+static void *grow(void *arr, u32 *cap, u32 need, u32 size) {
+    if (need <= *cap) {
+        return arr;
+    }
+    while (*cap < need) {
+        *cap = *cap ? *cap * 2 : 64;
+    }
+    return realloc(arr, (size_t) *cap * size);
+}
+
+static char *skip_space(char *s) {
+    while (isspace((u8) *s)) {
+        s++;
+    }
+    return s;
+}
+
+static void trim(char *s) {
+    u32 len = strlen(s);
+    while (len > 0 && isspace((u8) s[len - 1])) {
+        s[--len] = '\0';
+    }
+}
+
+static bool parse_reg(const char *s, regs_t *reg) {
+    if (s[0] != '$') {
+        return false;
+    }
+    if (isdigit((u8) s[1])) {
+        char *end;
+        long  num = strtol(s + 1, &end, 10);
+        if (*end != '\0' || num < 0 || num >= (long) ARR_LEN(REG_STRS)) {
+            return false;
+        }
+        *reg = (regs_t) num;
+        return true;
+    }
+    for (u32 i = 0; i < ARR_LEN(REG_STRS); i++) {
+        if (!strcmp(s, REG_STRS[i])) {
+            *reg = (regs_t) i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool parse_imm(const char *s, i32 *imm) {
+    char     *end;
+    long long num = strtoll(s, &end, 0);
+    if (end == s || *skip_space(end) != '\0' || num < INT32_MIN || num > UINT32_MAX) {
+        return false;
+    }
+    *imm = (i32) (u32) num;
+    return true;
+}
+
+static bool parse_sym(const char *s, char *sym) {
+    u32 len = strlen(s);
+    if (len == 0 || len >= MAX_SYM_LEN) {
+        return false;
+    }
+    for (u32 i = 0; i < len; i++) {
+        if (!isalnum((u8) s[i]) && s[i] != '_' && s[i] != '.') {
+            return false;
+        }
+    }
+    strcpy(sym, s);
+    return true;
+}
+
+// `imm($reg)`, the immediate may be omitted
+static bool parse_mem(char *s, i32 *imm, regs_t *reg) {
+    char *lp = strchr(s, '('), *rp = strchr(s, ')');
+    if (!lp || !rp || rp < lp || *skip_space(rp + 1) != '\0') {
+        return false;
+    }
+    *lp = *rp = '\0';
+    trim(s);
+    *imm = 0;
+    if (*s != '\0' && !parse_imm(s, imm)) {
+        return false;
+    }
+    return parse_reg(skip_space(lp + 1), reg);
+}
+
+static bool fits_i16(i32 imm) {
+    return imm >= -32768 && imm < 32768;
+}
+
+// machine instructions a pseudo instruction expands to, as SPIM does it
+static u32 inst_width(const minst_t *inst) {
+    switch (inst->kind) {
+        case MI_LI: return (fits_i16(inst->imm) || (inst->imm >= 0 && inst->imm <= 0xffff)) ? 1 : 2;
+        case MI_ADDI:
+        case MI_ADDIU:
+        case MI_SLTI:
+        case MI_SLTIU: return fits_i16(inst->imm) ? 1 : 3;
+        case MI_ANDI:
+        case MI_ORI:
+        case MI_XORI: return (inst->imm >= 0 && inst->imm <= 0xffff) ? 1 : 3;
+        case MI_LA:
+        case MI_DIV:
+        case MI_BLT:
+        case MI_BGT:
+        case MI_BLE:
+        case MI_BGE: return 2;
+        default: return 1;
+    }
+}
+
+static bool parse_inst(parser_t *p, char *mnem, char *rest) {
+    minst_kind_t kind = MI_NULL;
+    for (u32 i = 1; i < ARR_LEN(MINST_NAMES); i++) {
+        if (!strcmp(mnem, MINST_NAMES[i])) {
+            kind = (minst_kind_t) i;
+            break;
+        }
+    }
+    if (kind == MI_NULL) {
+        return false;
+    }
+
+    char *ops[3] = {NULL};
+    u32   nops   = 0;
+    for (char *s = rest; *s != '\0';) {
+        if (nops == ARR_LEN(ops)) {
+            return false;
+        }
+        char *comma = strchr(s, ',');
+        if (comma) {
+            *comma = '\0';
+        }
+        ops[nops] = skip_space(s);
+        trim(ops[nops]);
+        nops++;
+        if (!comma) {
+            break;
+        }
+        s = comma + 1;
+    }
+
+    mips_prog *prog = p->prog;
+    if (prog->ntext == p->cap_text) {
+        prog->text = grow(prog->text, &p->cap_text, prog->ntext + 1, sizeof(minst_t));
+        p->refs    = realloc(p->refs, (size_t) p->cap_text * MAX_SYM_LEN);
+    }
+
+    minst_t *inst = &prog->text[prog->ntext];
+    char    *ref  = p->refs[prog->ntext];
+    *inst         = (minst_t){.kind = kind, .lineno = p->lineno};
+    ref[0]        = '\0';
+
+    bool ok = false;
+    switch (MINST_FMTS[kind]) {
+        case MF_NONE: ok = nops == 0; break;
+        case MF_R2: ok = nops == 2 && parse_reg(ops[0], &inst->rd) && parse_reg(ops[1], &inst->rs); break;
+        case MF_R3:
+            ok = nops == 3 && parse_reg(ops[0], &inst->rd) && parse_reg(ops[1], &inst->rs) && parse_reg(ops[2], &inst->rt);
+            break;
+        case MF_RI:
+            ok = nops == 3 && parse_reg(ops[0], &inst->rt) && parse_reg(ops[1], &inst->rs) && parse_imm(ops[2], &inst->imm);
+            break;
+        case MF_LI: ok = nops == 2 && parse_reg(ops[0], &inst->rt) && parse_imm(ops[1], &inst->imm); break;
+        case MF_LA: ok = nops == 2 && parse_reg(ops[0], &inst->rt) && parse_sym(ops[1], ref); break;
+        case MF_MEM: ok = nops == 2 && parse_reg(ops[0], &inst->rt) && parse_mem(ops[1], &inst->imm, &inst->rs); break;
+        case MF_BR:
+            ok = nops == 3 && parse_reg(ops[0], &inst->rs) && parse_reg(ops[1], &inst->rt) && parse_sym(ops[2], ref);
+            break;
+        case MF_BRZ: ok = nops == 2 && parse_reg(ops[0], &inst->rs) && parse_sym(ops[1], ref); break;
+        case MF_J: ok = nops == 1 && parse_sym(ops[0], ref); break;
+        case MF_JR: ok = nops == 1 && parse_reg(ops[0], &inst->rs); break;
+        default: UNREACHABLE;
+    }
+    if (!ok) {
+        return false;
+    }
+    inst->width = inst_width(inst);
+    p->addr += 4 * inst->width;
+    prog->ntext++;
+    return true;
+}
+
+static void data_put(parser_t *p, const void *bytes, u32 size) {
+    mips_prog *prog = p->prog;
+    prog->data      = grow(prog->data, &p->cap_data, prog->ndata + size, 1);
+    if (bytes) {
+        memcpy(prog->data + prog->ndata, bytes, size);
+    } else {
+        memset(prog->data + prog->ndata, 0, size);
+    }
+    prog->ndata += size;
+}
+
+static void data_align(parser_t *p, u32 align) {
+    u32 pad = (align - p->prog->ndata % align) % align;
+    data_put(p, NULL, pad);
+}
+
+static bool parse_asciiz(parser_t *p, char *s) {
+    if (*s != '"') {
+        return false;
+    }
+    for (s++; *s != '"'; s++) {
+        char ch = *s;
+        if (ch == '\0') {
+            return false;
+        }
+        if (ch == '\\') {
+            switch (*++s) {
+                case 'n': ch = '\n'; break;
+                case 't': ch = '\t'; break;
+                case '0': ch = '\0'; break;
+                case '\\':
+                case '"': ch = *s; break;
+                default: return false;
+            }
+        }
+        data_put(p, &ch, 1);
+    }
+    data_put(p, "", 1);
+    return *skip_space(s + 1) == '\0';
+}
+
+static bool parse_directive(parser_t *p, char *dir, char *rest) {
+    if (!strcmp(dir, ".data")) {
+        p->in_text = false;
+    } else if (!strcmp(dir, ".text")) {
+        p->in_text = true;
+    } else if (!strcmp(dir, ".globl")) {
+        // every label is visible
+    } else if (p->in_text) {
+        return false;
+    } else if (!strcmp(dir, ".asciiz")) {
+        return parse_asciiz(p, rest);
+    } else if (!strcmp(dir, ".word")) {
+        data_align(p, 4);
+        for (char *tok = strtok(rest, ","); tok; tok = strtok(NULL, ",")) {
+            i32 word;
+            if (!parse_imm(skip_space(tok), &word)) {
+                return false;
+            }
+            data_put(p, &word, 4);
+        }
+    } else if (!strcmp(dir, ".space")) {
+        i32 size;
+        if (!parse_imm(rest, &size) || size < 0) {
+            return false;
+        }
+        data_put(p, NULL, size);
+    } else if (!strcmp(dir, ".align")) {
+        i32 power;
+        if (!parse_imm(rest, &power) || power < 0 || power > 12) {
+            return false;
+        }
+        data_align(p, 1u << power);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static void add_label(parser_t *p, const char *str) {
+    mips_prog *prog = p->prog;
+    prog->labels    = grow(prog->labels, &p->cap_label, prog->nlabel + 1, sizeof(mlabel_t));
+    mlabel_t *label = &prog->labels[prog->nlabel++];
+    strcpy(label->str, str);
+    label->text = p->in_text;
+    label->addr = p->in_text ? MTEXT_BASE + p->addr : MDATA_BASE + p->prog->ndata;
+}
+
+// cut the comment off, respecting string literals
+static void strip_comment(char *line) {
+    bool quoted = false;
+    for (char *s = line; *s; s++) {
+        if (*s == '"' && (s == line || s[-1] != '\\')) {
+            quoted = !quoted;
+        } else if (*s == '#' && !quoted) {
+            *s = '\0';
+            return;
+        }
+    }
+}
+
+static bool parse_line(parser_t *p, char *line) {
+    strip_comment(line);
+    char *s = skip_space(line);
+    for (char *colon; (colon = strchr(s, ':'));) {
+        char *quote = strchr(s, '"');
+        if (quote && quote < colon) {
+            break;
+        }
+        *colon = '\0';
+        char sym[MAX_SYM_LEN];
+        trim(s);
+        if (!parse_sym(s, sym)) {
+            return false;
+        }
+        add_label(p, sym);
+        s = skip_space(colon + 1);
+    }
+    if (s[0] == '\0') {
+        return true;
+    }
+    char *word = s;
+    while (*s && !isspace((u8) *s)) {
+        s++;
+    }
+    if (*s) {
+        *s++ = '\0';
+    }
+    s = skip_space(s);
+    trim(s);
+    if (word[0] == '.') {
+        return parse_directive(p, word, s);
+    }
+    return p->in_text && parse_inst(p, word, s);
+}
+
+static i32 label_cmp(const void *lhs, const void *rhs) {
+    return strcmp(((const mlabel_t *) lhs)->str, ((const mlabel_t *) rhs)->str);
+}
+
+const mlabel_t *mips_label(const mips_prog *prog, const char *str) {
+    mlabel_t key;
+    strncpy(key.str, str, MAX_SYM_LEN - 1);
+    key.str[MAX_SYM_LEN - 1] = '\0';
+    return bsearch(&key, prog->labels, prog->nlabel, sizeof(mlabel_t), label_cmp);
+}
+
+i32 mips_text_index(const mips_prog *prog, u32 addr) {
+    u32 lo = 0, hi = prog->ntext;
+    while (lo < hi) {
+        u32 mid = (lo + hi) / 2;
+        u32 cur = prog->text[mid].addr;
+        if (cur == addr) {
+            return mid;
+        } else if (cur < addr) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return -1;
+}
+
+mips_prog *mips_asm_parse(FILE *file) {
+    static char line[MAX_LINE];
+
+    parser_t p = {.prog = zalloc(sizeof(mips_prog)), .in_text = true};
+    while (fgets(line, MAX_LINE, file)) {
+        p.lineno++;
+        if (!parse_line(&p, line)) {
+            fprintf(stderr, "asm: cannot parse line %u\n", p.lineno);
+            goto fail;
+        }
+    }
+
+    mips_prog *prog = p.prog;
+    qsort(prog->labels, prog->nlabel, sizeof(mlabel_t), label_cmp);
+    for (u32 i = 1; i < prog->nlabel; i++) {
+        if (!strcmp(prog->labels[i - 1].str, prog->labels[i].str)) {
+            fprintf(stderr, "asm: duplicated label %s\n", prog->labels[i].str);
+            goto fail;
+        }
+    }
+    for (u32 i = 0, addr = MTEXT_BASE; i < prog->ntext; i++) {
+        minst_t *inst = &prog->text[i];
+        inst->addr    = addr;
+        addr += 4 * inst->width;
+        if (p.refs[i][0] == '\0') {
+            continue;
+        }
+        const mlabel_t *label = mips_label(prog, p.refs[i]);
+        if (!label || (label->text != (inst->kind != MI_LA))) {
+            fprintf(stderr, "asm: bad label %s at line %u\n", p.refs[i], inst->lineno);
+            goto fail;
+        }
+        inst->target = label->addr;
+    }
+    for (u32 i = 0; i < prog->ntext; i++) {
+        minst_t *inst = &prog->text[i];
+        inst->tindex  = (MINST_FMTS[inst->kind] == MF_BR ||
+                        MINST_FMTS[inst->kind] == MF_BRZ ||
+                        MINST_FMTS[inst->kind] == MF_J)
+                            ? mips_text_index(prog, inst->target)
+                            : -1;
+    }
+    const mlabel_t *entry = mips_label(prog, "main");
+    if (!entry || !entry->text) {
+        fprintf(stderr, "asm: no main\n");
+        goto fail;
+    }
+    prog->entry = entry->addr;
+    free(p.refs);
+    return prog;
+
+fail:
+    free(p.refs);
+    mips_prog_free(p.prog);
+    return NULL;
+}
+
+void mips_prog_free(mips_prog *prog) {
+    if (!prog) {
+        return;
+    }
+    free(prog->text);
+    free(prog->data);
+    free(prog->labels);
+    zfree(prog);
+}
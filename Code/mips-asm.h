@@ -0,0 +1,122 @@
+#pragma once
+#include "common.h"
+#include "mips.h"
+#include <stdbool.h>
+
+/**
+ * Parsed form of the assembly `mips_gen` writes, shared by the simulator.
+ * Only the subset we emit is understood; pseudo instructions stay as one
+ * minst_t and `width` says how many machine instructions they expand to.
+ */
+
+// operand shapes
+#define MFMTS(F) \
+    F(MF_NONE)   \
+    F(MF_R2)     \
+    F(MF_R3)     \
+    F(MF_RI)     \
+    F(MF_LI)     \
+    F(MF_LA)     \
+    F(MF_MEM)    \
+    F(MF_BR)     \
+    F(MF_BRZ)    \
+    F(MF_J)      \
+    F(MF_JR)
+
+typedef enum {
+    MFMTS(LIST)
+} mfmt_t;
+
+#define MINSTS(F)                \
+    F(MI_ADD, "add", MF_R3)      \
+    F(MI_ADDU, "addu", MF_R3)    \
+    F(MI_SUB, "sub", MF_R3)      \
+    F(MI_SUBU, "subu", MF_R3)    \
+    F(MI_MUL, "mul", MF_R3)      \
+    F(MI_DIV, "div", MF_R3)      \
+    F(MI_AND, "and", MF_R3)      \
+    F(MI_OR, "or", MF_R3)        \
+    F(MI_XOR, "xor", MF_R3)      \
+    F(MI_SLT, "slt", MF_R3)      \
+    F(MI_SLTU, "sltu", MF_R3)    \
+    F(MI_ADDI, "addi", MF_RI)    \
+    F(MI_ADDIU, "addiu", MF_RI)  \
+    F(MI_ANDI, "andi", MF_RI)    \
+    F(MI_ORI, "ori", MF_RI)      \
+    F(MI_XORI, "xori", MF_RI)    \
+    F(MI_SLTI, "slti", MF_RI)    \
+    F(MI_SLTIU, "sltiu", MF_RI)  \
+    F(MI_SLL, "sll", MF_RI)      \
+    F(MI_SRA, "sra", MF_RI)      \
+    F(MI_LI, "li", MF_LI)        \
+    F(MI_LUI, "lui", MF_LI)      \
+    F(MI_LA, "la", MF_LA)        \
+    F(MI_MOVE, "move", MF_R2)    \
+    F(MI_LW, "lw", MF_MEM)       \
+    F(MI_SW, "sw", MF_MEM)       \
+    F(MI_BEQ, "beq", MF_BR)      \
+    F(MI_BNE, "bne", MF_BR)      \
+    F(MI_BLT, "blt", MF_BR)      \
+    F(MI_BGT, "bgt", MF_BR)      \
+    F(MI_BLE, "ble", MF_BR)      \
+    F(MI_BGE, "bge", MF_BR)      \
+    F(MI_BEQZ, "beqz", MF_BRZ)   \
+    F(MI_BNEZ, "bnez", MF_BRZ)   \
+    F(MI_J, "j", MF_J)           \
+    F(MI_JAL, "jal", MF_J)       \
+    F(MI_JR, "jr", MF_JR)        \
+    F(MI_SYSCALL, "syscall", MF_NONE)
+
+#define MINST_KIND(KIND, NAME, FMT) KIND,
+
+typedef enum {
+    MI_NULL,
+    MINSTS(MINST_KIND)
+} minst_kind_t;
+
+extern const char  *MINST_NAMES[];
+extern const mfmt_t MINST_FMTS[];
+
+#define MTEXT_BASE 0x00400000u
+#define MDATA_BASE 0x10010000u
+
+typedef struct minst_t   minst_t;
+typedef struct mlabel_t  mlabel_t;
+typedef struct mips_prog mips_prog;
+
+struct minst_t {
+    minst_kind_t kind;
+    regs_t       rd, rs, rt;
+    i32          imm;
+    u32          addr;
+    u32          target; // address of the label operand
+    i32          tindex; // text index of `target`, -1 if not a jump
+    u32          width;  // machine instructions after expansion
+    u32          lineno;
+};
+
+struct mlabel_t {
+    char str[MAX_SYM_LEN];
+    u32  addr;
+    bool text;
+};
+
+struct mips_prog {
+    minst_t  *text;
+    u32       ntext;
+    u8       *data;
+    u32       ndata;
+    mlabel_t *labels;
+    u32       nlabel;
+    u32       entry;
+};
+
+// NULL on malformed input, after reporting the line to stderr
+mips_prog *mips_asm_parse(FILE *file);
+
+void mips_prog_free(mips_prog *prog);
+
+const mlabel_t *mips_label(const mips_prog *prog, const char *str);
+
+// index of the instruction at `addr`, or -1 outside .text
+i32 mips_text_index(const mips_prog *prog, u32 addr);
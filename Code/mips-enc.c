@@ -0,0 +1,508 @@
+#include "mips-enc.h"
+#include <elf.h>
+#include <string.h>
+
+static const char *REG_STRS[] = {REGS(STRING_LIST)};
+
+// opcodes, and the functs under SPECIAL and SPECIAL2
+enum {
+    OPC_SPECIAL  = 0x00,
+    OPC_J        = 0x02,
+    OPC_JAL      = 0x03,
+    OPC_BEQ      = 0x04,
+    OPC_BNE      = 0x05,
+    OPC_ADDI     = 0x08,
+    OPC_ADDIU    = 0x09,
+    OPC_SLTI     = 0x0a,
+    OPC_SLTIU    = 0x0b,
+    OPC_ANDI     = 0x0c,
+    OPC_ORI      = 0x0d,
+    OPC_XORI     = 0x0e,
+    OPC_LUI      = 0x0f,
+    OPC_SPECIAL2 = 0x1c,
+    OPC_LW       = 0x23,
+    OPC_SW       = 0x2b,
+};
+
+enum {
+    FN_SLL     = 0x00,
+    FN_SRA     = 0x03,
+    FN_JR      = 0x08,
+    FN_SYSCALL = 0x0c,
+    FN_MFLO    = 0x12,
+    FN_DIV     = 0x1a,
+    FN_ADD     = 0x20,
+    FN_ADDU    = 0x21,
+    FN_SUB     = 0x22,
+    FN_SUBU    = 0x23,
+    FN_AND     = 0x24,
+    FN_OR      = 0x25,
+    FN_XOR     = 0x26,
+    FN_SLT     = 0x2a,
+    FN_SLTU    = 0x2b,
+    FN2_MUL    = 0x02,
+};
+
+// the funct of a three register instruction, and of what an immediate one
+// becomes when its immediate needs `$at`
+static const u8 FUNCTS[] = {
+    [MI_ADD] = FN_ADD,
+    [MI_ADDU] = FN_ADDU,
+    [MI_SUB] = FN_SUB,
+    [MI_SUBU] = FN_SUBU,
+    [MI_AND] = FN_AND,
+    [MI_OR] = FN_OR,
+    [MI_XOR] = FN_XOR,
+    [MI_SLT] = FN_SLT,
+    [MI_SLTU] = FN_SLTU,
+    [MI_ADDI] = FN_ADD,
+    [MI_ADDIU] = FN_ADDU,
+    [MI_SLTI] = FN_SLT,
+    [MI_SLTIU] = FN_SLTU,
+    [MI_ANDI] = FN_AND,
+    [MI_ORI] = FN_OR,
+    [MI_XORI] = FN_XOR,
+};
+
+static const u8 OPCODES[] = {
+    [MI_ADDI] = OPC_ADDI,
+    [MI_ADDIU] = OPC_ADDIU,
+    [MI_SLTI] = OPC_SLTI,
+    [MI_SLTIU] = OPC_SLTIU,
+    [MI_ANDI] = OPC_ANDI,
+    [MI_ORI] = OPC_ORI,
+    [MI_XORI] = OPC_XORI,
+    [MI_LW] = OPC_LW,
+    [MI_SW] = OPC_SW,
+    [MI_J] = OPC_J,
+    [MI_JAL] = OPC_JAL,
+};
+
+typedef struct {
+    const mips_prog *prog;
+    const minst_t   *inst;
+    mcode_t         *code;
+    bool             bad;
+} enc_t;
+
+static u32 r_type(u32 rs, u32 rt, u32 rd, u32 shamt, u32 funct) {
+    return rs << 21 | rt << 16 | rd << 11 | shamt << 6 | funct;
+}
+
+static u32 i_type(u32 opcode, u32 rs, u32 rt, u32 imm) {
+    return opcode << 26 | rs << 21 | rt << 16 | (imm & 0xffff);
+}
+
+static void put(enc_t *enc, u32 word) {
+    enc->code->words[enc->code->nword++] = word;
+}
+
+static u32 here(const enc_t *enc) {
+    return enc->code->text_base + 4 * enc->code->nword;
+}
+
+static void reloc(enc_t *enc, u8 type, bool data) {
+    mcode_t *code              = enc->code;
+    code->relocs[code->nreloc++] = (mreloc_t){4 * code->nword, type, data};
+}
+
+static void misfit(enc_t *enc, const char *what) {
+    fprintf(stderr, "enc: %s out of range at line %u\n", what, enc->inst->lineno);
+    enc->bad = true;
+}
+
+static bool fits_i16(i32 imm) {
+    return imm >= -32768 && imm < 32768;
+}
+
+static bool fits_u16(i32 imm) {
+    return imm >= 0 && imm <= 0xffff;
+}
+
+// `$at` := `imm`, in two words
+static void load_at(enc_t *enc, i32 imm) {
+    put(enc, i_type(OPC_LUI, 0, $at, (u32) imm >> 16));
+    put(enc, i_type(OPC_ORI, $at, $at, imm));
+}
+
+// branches if `rs` `op` `rt`, from the word put next
+static void branch(enc_t *enc, u32 opcode, regs_t rs, regs_t rt) {
+    i32 offset = (i32) (enc->inst->target - MTEXT_BASE + enc->code->text_base - (here(enc) + 4)) >> 2;
+    if (!fits_i16(offset)) {
+        misfit(enc, "branch");
+    }
+    put(enc, i_type(opcode, rs, rt, offset));
+}
+
+static void encode_inst(enc_t *enc, const minst_t *inst) {
+    enc->inst = inst;
+    switch (inst->kind) {
+        case MI_ADD:
+        case MI_ADDU:
+        case MI_SUB:
+        case MI_SUBU:
+        case MI_AND:
+        case MI_OR:
+        case MI_XOR:
+        case MI_SLT:
+        case MI_SLTU: put(enc, r_type(inst->rs, inst->rt, inst->rd, 0, FUNCTS[inst->kind])); break;
+        case MI_MUL: put(enc, OPC_SPECIAL2 << 26 | r_type(inst->rs, inst->rt, inst->rd, 0, FN2_MUL)); break;
+        case MI_DIV:
+            put(enc, r_type(inst->rs, inst->rt, 0, 0, FN_DIV));
+            put(enc, r_type(0, 0, inst->rd, 0, FN_MFLO));
+            break;
+        case MI_ADDI:
+        case MI_ADDIU:
+        case MI_SLTI:
+        case MI_SLTIU:
+        case MI_ANDI:
+        case MI_ORI:
+        case MI_XORI:
+            if (inst->width == 1) {
+                put(enc, i_type(OPCODES[inst->kind], inst->rs, inst->rt, inst->imm));
+            } else {
+                load_at(enc, inst->imm);
+                put(enc, r_type(inst->rs, $at, inst->rt, 0, FUNCTS[inst->kind]));
+            }
+            break;
+        case MI_SLL:
+        case MI_SRA:
+            if (inst->imm < 0 || inst->imm > 31) {
+                misfit(enc, "shift");
+            }
+            put(enc, r_type(0, inst->rs, inst->rt, inst->imm & 31, inst->kind == MI_SLL ? FN_SLL : FN_SRA));
+            break;
+        case MI_LI:
+            if (inst->width == 2) {
+                put(enc, i_type(OPC_LUI, 0, $at, (u32) inst->imm >> 16));
+                put(enc, i_type(OPC_ORI, $at, inst->rt, inst->imm));
+            } else {
+                put(enc, i_type(fits_i16(inst->imm) ? OPC_ADDIU : OPC_ORI, 0, inst->rt, inst->imm));
+            }
+            break;
+        case MI_LUI:
+            if (!fits_i16(inst->imm) && !fits_u16(inst->imm)) {
+                misfit(enc, "immediate");
+            }
+            put(enc, i_type(OPC_LUI, 0, inst->rt, inst->imm));
+            break;
+        case MI_LA: {
+            // %hi carries what the signed %lo takes away
+            u32 addr = inst->target - MDATA_BASE + enc->code->data_base;
+            reloc(enc, R_MIPS_HI16, true);
+            put(enc, i_type(OPC_LUI, 0, $at, (addr + 0x8000) >> 16));
+            reloc(enc, R_MIPS_LO16, true);
+            put(enc, i_type(OPC_ADDIU, $at, inst->rt, addr));
+            break;
+        }
+        case MI_MOVE: put(enc, r_type(inst->rs, 0, inst->rd, 0, FN_ADDU)); break;
+        case MI_LW:
+        case MI_SW:
+            if (!fits_i16(inst->imm)) {
+                misfit(enc, "offset");
+            }
+            put(enc, i_type(OPCODES[inst->kind], inst->rs, inst->rt, inst->imm));
+            break;
+        case MI_BEQ: branch(enc, OPC_BEQ, inst->rs, inst->rt); break;
+        case MI_BNE: branch(enc, OPC_BNE, inst->rs, inst->rt); break;
+        case MI_BEQZ: branch(enc, OPC_BEQ, inst->rs, $zero); break;
+        case MI_BNEZ: branch(enc, OPC_BNE, inst->rs, $zero); break;
+        case MI_BLT:
+        case MI_BGE:
+            put(enc, r_type(inst->rs, inst->rt, $at, 0, FN_SLT));
+            branch(enc, inst->kind == MI_BLT ? OPC_BNE : OPC_BEQ, $at, $zero);
+            break;
+        case MI_BGT:
+        case MI_BLE:
+            put(enc, r_type(inst->rt, inst->rs, $at, 0, FN_SLT));
+            branch(enc, inst->kind == MI_BGT ? OPC_BNE : OPC_BEQ, $at, $zero);
+            break;
+        case MI_J:
+        case MI_JAL: {
+            u32 addr = inst->target - MTEXT_BASE + enc->code->text_base;
+            if ((addr ^ (here(enc) + 4)) & 0xf0000000) {
+                misfit(enc, "jump");
+            }
+            reloc(enc, R_MIPS_26, false);
+            put(enc, OPCODES[inst->kind] << 26 | (addr >> 2 & 0x3ffffff));
+            break;
+        }
+        case MI_JR: put(enc, r_type(inst->rs, 0, 0, 0, FN_JR)); break;
+        case MI_SYSCALL: put(enc, FN_SYSCALL); break;
+        default: UNREACHABLE;
+    }
+}
+
+mcode_t *mips_encode(const mips_prog *prog, u32 text_base, u32 data_base) {
+    u32 nword = 0;
+    for (u32 i = 0; i < prog->ntext; i++) {
+        nword += prog->text[i].width;
+    }
+    mcode_t *code   = zalloc(sizeof(mcode_t));
+    code->words     = zalloc(sizeof(u32) * (nword + 1));
+    code->relocs    = zalloc(sizeof(mreloc_t) * (2 * prog->ntext + 1));
+    code->text_base = text_base;
+    code->data_base = data_base;
+
+    enc_t enc = {.prog = prog, .code = code};
+    for (u32 i = 0; i < prog->ntext && !enc.bad; i++) {
+        encode_inst(&enc, &prog->text[i]);
+        ASSERT(here(&enc) - text_base == prog->text[i].addr - MTEXT_BASE + 4 * prog->text[i].width,
+               "%s is not %u words", MINST_NAMES[prog->text[i].kind], prog->text[i].width);
+    }
+    if (enc.bad) {
+        mips_code_free(code);
+        return NULL;
+    }
+    return code;
+}
+
+void mips_code_free(mcode_t *code) {
+    if (!code) {
+        return;
+    }
+    zfree(code->words);
+    zfree(code->relocs);
+    zfree(code);
+}
+
+static void pad(FILE *file, u32 *pos, u32 to) {
+    for (; *pos < to; (*pos)++) {
+        fputc(0, file);
+    }
+}
+
+static void out(FILE *file, u32 *pos, const void *data, u32 size) {
+    fwrite(data, 1, size, file);
+    *pos += size;
+}
+
+#define ALIGN4(N) (((N) + 3) & ~3u)
+
+enum {
+    SEC_NULL,
+    SEC_TEXT,
+    SEC_DATA,
+    SEC_REL,
+    SEC_SYMTAB,
+    SEC_STRTAB,
+    SEC_SHSTRTAB,
+    NSEC,
+};
+
+void mips_write_elf(FILE *file, const mips_prog *prog, const mcode_t *code) {
+    static const char SHSTRTAB[] = "\0.text\0.data\0.rel.text\0.symtab\0.strtab\0.shstrtab";
+    static const u32  SHNAMES[]  = {0, 1, 7, 13, 23, 31, 39};
+
+    // the section symbols, the labels, and `main` last as the only global
+    u32        nsym = 3 + prog->nlabel, nstr = 1;
+    Elf32_Sym *syms = zalloc(sizeof(Elf32_Sym) * nsym);
+    for (u32 i = 0; i < prog->nlabel; i++) {
+        nstr += strlen(prog->labels[i].str) + 1;
+    }
+    char *strtab = zalloc(nstr);
+    syms[1]      = (Elf32_Sym){.st_info = ELF32_ST_INFO(STB_LOCAL, STT_SECTION), .st_shndx = SEC_TEXT};
+    syms[2]      = (Elf32_Sym){.st_info = ELF32_ST_INFO(STB_LOCAL, STT_SECTION), .st_shndx = SEC_DATA};
+    u32 isym = 3, istr = 1, iglobal = nsym;
+    for (u32 i = 0; i < prog->nlabel; i++) {
+        const mlabel_t *label = &prog->labels[i];
+        bool            main  = !strcmp(label->str, "main");
+        Elf32_Sym      *sym   = &syms[main ? --iglobal : isym++];
+        *sym                  = (Elf32_Sym){
+                             .st_name  = istr,
+                             .st_value = label->text ? label->addr - MTEXT_BASE : label->addr - MDATA_BASE,
+                             .st_info  = ELF32_ST_INFO(main ? STB_GLOBAL : STB_LOCAL,
+                                                      main ? STT_FUNC : label->text ? STT_NOTYPE : STT_OBJECT),
+                             .st_shndx = label->text ? SEC_TEXT : SEC_DATA};
+        strcpy(strtab + istr, label->str);
+        istr += strlen(label->str) + 1;
+    }
+
+    Elf32_Rel *rels = zalloc(sizeof(Elf32_Rel) * (code->nreloc + 1));
+    for (u32 i = 0; i < code->nreloc; i++) {
+        const mreloc_t *rel = &code->relocs[i];
+        rels[i]             = (Elf32_Rel){rel->offset, ELF32_R_INFO(rel->data ? 2 : 1, rel->type)};
+    }
+
+    u32 size[NSEC] = {
+        [SEC_TEXT]     = 4 * code->nword,
+        [SEC_DATA]     = prog->ndata,
+        [SEC_REL]      = sizeof(Elf32_Rel) * code->nreloc,
+        [SEC_SYMTAB]   = sizeof(Elf32_Sym) * nsym,
+        [SEC_STRTAB]   = nstr,
+        [SEC_SHSTRTAB] = sizeof(SHSTRTAB),
+    };
+    const void *data[NSEC] = {
+        [SEC_TEXT]     = code->words,
+        [SEC_DATA]     = prog->data,
+        [SEC_REL]      = rels,
+        [SEC_SYMTAB]   = syms,
+        [SEC_STRTAB]   = strtab,
+        [SEC_SHSTRTAB] = SHSTRTAB,
+    };
+    Elf32_Shdr shdrs[NSEC] = {0};
+    u32        offset      = sizeof(Elf32_Ehdr);
+    for (u32 i = 1; i < NSEC; i++) {
+        offset   = ALIGN4(offset);
+        shdrs[i] = (Elf32_Shdr){
+            .sh_name      = SHNAMES[i],
+            .sh_type      = SHT_PROGBITS,
+            .sh_offset    = offset,
+            .sh_size      = size[i],
+            .sh_addralign = i <= SEC_SYMTAB ? 4 : 1};
+        offset += size[i];
+    }
+    shdrs[SEC_TEXT].sh_flags    = SHF_ALLOC | SHF_EXECINSTR;
+    shdrs[SEC_DATA].sh_flags    = SHF_ALLOC | SHF_WRITE;
+    shdrs[SEC_REL].sh_type      = SHT_REL;
+    shdrs[SEC_REL].sh_flags     = SHF_INFO_LINK;
+    shdrs[SEC_REL].sh_link      = SEC_SYMTAB;
+    shdrs[SEC_REL].sh_info      = SEC_TEXT;
+    shdrs[SEC_REL].sh_entsize   = sizeof(Elf32_Rel);
+    shdrs[SEC_SYMTAB].sh_type   = SHT_SYMTAB;
+    shdrs[SEC_SYMTAB].sh_link   = SEC_STRTAB;
+    shdrs[SEC_SYMTAB].sh_info   = iglobal;
+    shdrs[SEC_SYMTAB].sh_entsize = sizeof(Elf32_Sym);
+    shdrs[SEC_STRTAB].sh_type   = SHT_STRTAB;
+    shdrs[SEC_SHSTRTAB].sh_type = SHT_STRTAB;
+
+    Elf32_Ehdr ehdr = {
+        .e_ident     = {ELFMAG0, ELFMAG1, ELFMAG2, ELFMAG3, ELFCLASS32, ELFDATA2LSB, EV_CURRENT, ELFOSABI_SYSV},
+        .e_type      = ET_REL,
+        .e_machine   = EM_MIPS,
+        .e_version   = EV_CURRENT,
+        .e_shoff     = ALIGN4(offset),
+        .e_flags     = EF_MIPS_ARCH_32 | EF_MIPS_NOREORDER,
+        .e_ehsize    = sizeof(Elf32_Ehdr),
+        .e_shentsize = sizeof(Elf32_Shdr),
+        .e_shnum     = NSEC,
+        .e_shstrndx  = SEC_SHSTRTAB};
+
+    u32 pos = 0;
+    out(file, &pos, &ehdr, sizeof(ehdr));
+    for (u32 i = 1; i < NSEC; i++) {
+        pad(file, &pos, shdrs[i].sh_offset);
+        out(file, &pos, data[i], size[i]);
+    }
+    pad(file, &pos, ehdr.e_shoff);
+    out(file, &pos, shdrs, sizeof(shdrs));
+    zfree(syms);
+    zfree(strtab);
+    zfree(rels);
+}
+
+void mips_write_raw(FILE *file, const mips_prog *prog, const mcode_t *code) {
+    u32 pos = 0;
+    out(file, &pos, code->words, 4 * code->nword);
+    pad(file, &pos, ALIGN4(pos));
+    out(file, &pos, prog->data, prog->ndata);
+}
+
+bool mips_decode(u32 word, u32 addr, char *buf, u32 size) {
+    u32         opcode = word >> 26, funct = word & 63, shamt = word >> 6 & 31;
+    const char *rs = REG_STRS[word >> 21 & 31], *rt = REG_STRS[word >> 16 & 31], *rd = REG_STRS[word >> 11 & 31];
+    i32         simm = (int16_t) (word & 0xffff);
+    u32         uimm = word & 0xffff;
+    const char *name = NULL;
+
+#define NAME(CODE, STR) \
+    case CODE: name = STR; break;
+
+    switch (opcode) {
+        case OPC_SPECIAL:
+            switch (funct) {
+                case FN_SLL:
+                case FN_SRA:
+                    if (word == 0) {
+                        snprintf(buf, size, "nop");
+                    } else {
+                        snprintf(buf, size, "%s %s, %s, %u", funct == FN_SLL ? "sll" : "sra", rd, rt, shamt);
+                    }
+                    return true;
+                case FN_JR: snprintf(buf, size, "jr %s", rs); return true;
+                case FN_SYSCALL: snprintf(buf, size, "syscall"); return true;
+                case FN_MFLO: snprintf(buf, size, "mflo %s", rd); return true;
+                case FN_DIV: snprintf(buf, size, "div %s, %s", rs, rt); return true;
+                    NAME(FN_ADD, "add")
+                    NAME(FN_ADDU, "addu")
+                    NAME(FN_SUB, "sub")
+                    NAME(FN_SUBU, "subu")
+                    NAME(FN_AND, "and")
+                    NAME(FN_OR, "or")
+                    NAME(FN_XOR, "xor")
+                    NAME(FN_SLT, "slt")
+                    NAME(FN_SLTU, "sltu")
+                default: break;
+            }
+            if (name == NULL) {
+                break;
+            }
+            snprintf(buf, size, "%s %s, %s, %s", name, rd, rs, rt);
+            return true;
+        case OPC_SPECIAL2:
+            if (funct != FN2_MUL) {
+                break;
+            }
+            snprintf(buf, size, "mul %s, %s, %s", rd, rs, rt);
+            return true;
+        case OPC_J:
+        case OPC_JAL:
+            snprintf(buf, size, "%s 0x%08x", opcode == OPC_J ? "j" : "jal",
+                     ((addr + 4) & 0xf0000000) | (word & 0x3ffffff) << 2);
+            return true;
+        case OPC_BEQ:
+        case OPC_BNE:
+            snprintf(buf, size, "%s %s, %s, 0x%08x", opcode == OPC_BEQ ? "beq" : "bne", rs, rt, addr + 4 + simm * 4);
+            return true;
+            NAME(OPC_ADDI, "addi")
+            NAME(OPC_ADDIU, "addiu")
+            NAME(OPC_SLTI, "slti")
+            NAME(OPC_SLTIU, "sltiu")
+        case OPC_ANDI:
+        case OPC_ORI:
+        case OPC_XORI:
+            name = opcode == OPC_ANDI ? "andi" : opcode == OPC_ORI ? "ori" : "xori";
+            snprintf(buf, size, "%s %s, %s, 0x%x", name, rt, rs, uimm);
+            return true;
+        case OPC_LUI: snprintf(buf, size, "lui %s, 0x%x", rt, uimm); return true;
+        case OPC_LW:
+        case OPC_SW:
+            snprintf(buf, size, "%s %s, %d(%s)", opcode == OPC_LW ? "lw" : "sw", rt, simm, rs);
+            return true;
+        default: break;
+    }
+#undef NAME
+    if (name != NULL) {
+        snprintf(buf, size, "%s %s, %s, %d", name, rt, rs, simm);
+        return true;
+    }
+    snprintf(buf, size, ".word 0x%08x", word);
+    return false;
+}
+
+static i32 label_addr_cmp(const void *lhs, const void *rhs) {
+    u32 l = (*(const mlabel_t **) lhs)->addr, r = (*(const mlabel_t **) rhs)->addr;
+    return l < r ? -1 : l > r;
+}
+
+void mips_disasm(FILE *file, const mips_prog *prog, const mcode_t *code) {
+    const mlabel_t **labels = zalloc(sizeof(mlabel_t *) * (prog->nlabel + 1));
+    u32              n      = 0;
+    for (u32 i = 0; i < prog->nlabel; i++) {
+        if (prog->labels[i].text) {
+            labels[n++] = &prog->labels[i];
+        }
+    }
+    qsort(labels, n, sizeof(mlabel_t *), label_addr_cmp);
+
+    char buf[64];
+    for (u32 i = 0, j = 0; i < code->nword; i++) {
+        u32 addr = code->text_base + 4 * i;
+        for (; j < n && labels[j]->addr - MTEXT_BASE <= 4 * i; j++) {
+            fprintf(file, "%s:\n", labels[j]->str);
+        }
+        mips_decode(code->words[i], addr, buf, sizeof(buf));
+        fprintf(file, "  %08x:  %08x  %s\n", addr, code->words[i], buf);
+    }
+    zfree(labels);
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "common.h"
+#include "mips-asm.h"
+#include <stdbool.h>
+
+/**
+ * MIPS32 machine code for a parsed program. Pseudo instructions expand to
+ * exactly the `width` words the parser laid them out with, `$at` being the
+ * scratch register, so the addresses it resolved hold. Like SPIM by
+ * default, the code assumes no branch delay slots.
+ */
+
+// a field the linker fills in, `offset` bytes into .text
+typedef struct {
+    u32  offset;
+    u8   type; // R_MIPS_26, R_MIPS_HI16 or R_MIPS_LO16
+    bool data; // against .data rather than .text
+} mreloc_t;
+
+typedef struct {
+    u32      *words;
+    u32       nword;
+    mreloc_t *relocs;
+    u32       nreloc;
+    u32       text_base, data_base;
+} mcode_t;
+
+// encodes `prog` as if loaded at `text_base` and `data_base`, NULL after
+// reporting to stderr an operand that does not fit its field
+mcode_t *mips_encode(const mips_prog *prog, u32 text_base, u32 data_base);
+
+void mips_code_free(mcode_t *code);
+
+// an ELF32 relocatable, little endian, with every label a symbol and `main`
+// the global one; `code` must be encoded at 0 and 0
+void mips_write_elf(FILE *file, const mips_prog *prog, const mcode_t *code);
+
+// .text and then .data, word aligned, the entry being `main`
+void mips_write_raw(FILE *file, const mips_prog *prog, const mcode_t *code);
+
+// `word` at `addr` in assembly, false if it is none of the instructions we encode
+bool mips_decode(u32 word, u32 addr, char *buf, u32 size);
+
+// the whole of .text, decoded, under the labels of `prog`
+void mips_disasm(FILE *file, const mips_prog *prog, const mcode_t *code);
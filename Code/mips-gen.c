@@ -1,9 +1,16 @@
+#define _DEFAULT_SOURCE
+#include "bench.h"
+#include "cache.h"
 #include "common.h"
-#include "mips.h"
 #include "ir.h"
+#include "mips-peep.h"
+#include "mips.h"
+#include "profile.h"
 #include "symtab.h"
 #include "visitor.h"
-#include <stdarg.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
 
 const char *REGS_NAMES[] = {REGS(STRING_LIST) "\0"};
 
@@ -11,34 +18,397 @@ const char *REGS_NAMES[] = {REGS(STRING_LIST) "\0"};
 #define ARG p_res
 VISITOR_DEF(IR, mips_gen, RET_TYPE);
 
+// stands for a callee frame in a code template, see cache.h
+#define FRAME_MARK "@frame "
+
+#define OUT_SIZE (1 << 16)
+
+// code on its way out, written to `fd` a chunk at a time, or kept whole
+// in memory for a template when `fd` is -1
+typedef struct {
+    char *data;
+    u32   len, cap;
+    i32   fd;
+} out_t;
+
 static ir_fun_t *cur_fun;
 static u32       narg;
-static FILE     *fout;
+static out_t    *out;
+static bool      templ;
+
+// the body of `cur_fun` so far
+static mline_t *lines;
+static u32      nline, line_cap;
+
+// `-asm-ir`: the IR comments are printed here first
+static FILE  *note;
+static char  *note_buf;
+static size_t note_size;
+
+static void out_flush(out_t *buf) {
+    for (u32 done = 0; done < buf->len;) {
+        ssize_t n = write(buf->fd, buf->data + done, buf->len - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n <= 0) {
+            perror("mips_gen");
+            break;
+        }
+        done += n;
+    }
+    buf->len = 0;
+}
+
+static void put(const char *str, u32 len) {
+    while (out->len + len > out->cap) {
+        if (out->fd < 0) {
+            out->cap  = out->cap * 2 + BUFSIZ;
+            out->data = realloc(out->data, out->cap);
+            continue;
+        }
+        u32 part = out->cap - out->len;
+        memcpy(out->data + out->len, str, part);
+        out->len += part;
+        str += part;
+        len -= part;
+        out_flush(out);
+    }
+    memcpy(out->data + out->len, str, len);
+    out->len += len;
+}
+
+static void put_str(const char *str) {
+    put(str, strlen(str));
+}
+
+static void put_chr(char c) {
+    put(&c, 1);
+}
+
+static void put_int(i32 val) {
+    char buf[16], *p = buf + sizeof(buf);
+    u32  abs = val < 0 ? -(u32) val : (u32) val;
+    do {
+        *--p = '0' + abs % 10;
+        abs /= 10;
+    } while (abs);
+    if (val < 0) {
+        *--p = '-';
+    }
+    put(p, buf + sizeof(buf) - p);
+}
+
+static void put_op(const char *op) {
+    put("  ", 2);
+    put_str(op);
+    put_chr(' ');
+}
+
+// `line` as it is
+static void emit(const char *line) {
+    put_str(line);
+    put_chr('\n');
+}
+
+// `  OP RD, RS, RT`
+static void emit_rrr(const char *op, regs_t rd, regs_t rs, regs_t rt) {
+    put_op(op);
+    put_str(REGS_NAMES[rd]);
+    put(", ", 2);
+    put_str(REGS_NAMES[rs]);
+    put(", ", 2);
+    put_str(REGS_NAMES[rt]);
+    put_chr('\n');
+}
+
+// `  OP RT, RS, IMM`
+static void emit_rri(const char *op, regs_t rt, regs_t rs, i32 imm) {
+    put_op(op);
+    put_str(REGS_NAMES[rt]);
+    put(", ", 2);
+    put_str(REGS_NAMES[rs]);
+    put(", ", 2);
+    put_int(imm);
+    put_chr('\n');
+}
+
+// `  OP RT, OFFSET(BASE)`
+static void emit_mem(const char *op, regs_t rt, i32 offset, regs_t base) {
+    put_op(op);
+    put_str(REGS_NAMES[rt]);
+    put(", ", 2);
+    put_int(offset);
+    put_chr('(');
+    put_str(REGS_NAMES[base]);
+    put(")\n", 2);
+}
 
-static void emit(const char *fmt, ...) {
-    va_list ap;
-    va_start(ap, fmt);
-    vfprintf(fout, fmt, ap);
-    fprintf(fout, "\n");
-    va_end(ap);
+static void emit_li(regs_t reg, i32 imm) {
+    put_op("li");
+    put_str(REGS_NAMES[reg]);
+    put(", ", 2);
+    put_int(imm);
+    put_chr('\n');
+}
+
+static void emit_la(regs_t reg, const char *label) {
+    put_op("la");
+    put_str(REGS_NAMES[reg]);
+    put(", ", 2);
+    put_str(label);
+    put_chr('\n');
+}
+
+// `  OP PREFIXLABEL`
+static void emit_jump(const char *op, const char *prefix, const char *label) {
+    put_op(op);
+    put_str(prefix);
+    put_str(label);
+    put_chr('\n');
+}
+
+// `  OP RS, RT, LABEL`
+static void emit_branch(const char *op, regs_t rs, regs_t rt, const char *label) {
+    put_op(op);
+    put_str(REGS_NAMES[rs]);
+    put(", ", 2);
+    put_str(REGS_NAMES[rt]);
+    put(", ", 2);
+    put_str(label);
+    put_chr('\n');
+}
+
+// `PREFIXLABEL:`
+static void emit_label(const char *prefix, const char *label) {
+    put_str(prefix);
+    put_str(label);
+    put(":\n", 2);
 }
 
 static void emit_sp(const i32 offset) {
     if (offset >= -32768 && offset < 32768) {
-        emit("  addi $sp, $sp, %d", offset);
+        emit_rri("addi", $sp, $sp, offset);
     } else {
-        emit("  li $t3, %d", offset);
-        emit("  add $sp, $sp, $t3", offset);
+        emit_li($t3, offset);
+        emit_rrr("add", $sp, $sp, $t3);
     }
 }
 
-static void mips_gen_fun(ir_fun_t *fun) {
-    emit("__fun__%s:", fun->str);
+static mline_t *gen(mline_kind_t line, minst_kind_t kind) {
+    if (nline == line_cap) {
+        line_cap = line_cap * 2 + 64;
+        lines    = realloc(lines, sizeof(mline_t) * line_cap);
+    }
+    mline_t *ml = &lines[nline++];
+    ml->line    = line;
+    ml->kind    = kind;
+    ml->note    = NULL;
+    return ml;
+}
+
+static void gen_rrr(minst_kind_t kind, regs_t rd, regs_t rs, regs_t rt) {
+    mline_t *ml = gen(ML_INST, kind);
+    ml->rd      = rd;
+    ml->rs      = rs;
+    ml->rt      = rt;
+}
+
+static void gen_rri(minst_kind_t kind, regs_t rt, regs_t rs, i32 imm) {
+    mline_t *ml = gen(ML_INST, kind);
+    ml->rt      = rt;
+    ml->rs      = rs;
+    ml->imm     = imm;
+}
+
+static void gen_mem(minst_kind_t kind, regs_t rt, i32 offset, regs_t base) {
+    gen_rri(kind, rt, base, offset);
+}
+
+static void gen_li(regs_t reg, i32 imm) {
+    gen_rri(MI_LI, reg, $zero, imm);
+}
+
+static void gen_la(regs_t reg, const char *label) {
+    mline_t *ml = gen(ML_INST, MI_LA);
+    ml->rt      = reg;
+    snprintf(ml->label, sizeof(ml->label), "%s", label);
+}
+
+static void gen_jump(minst_kind_t kind, const char *prefix, const char *label) {
+    mline_t *ml = gen(ML_INST, kind);
+    snprintf(ml->label, sizeof(ml->label), "%s%s", prefix, label);
+}
+
+static void gen_jr(regs_t reg) {
+    gen(ML_INST, MI_JR)->rs = reg;
+}
+
+static void gen_branch(minst_kind_t kind, regs_t rs, regs_t rt, const char *label) {
+    mline_t *ml = gen(ML_INST, kind);
+    ml->rs      = rs;
+    ml->rt      = rt;
+    snprintf(ml->label, sizeof(ml->label), "%s", label);
+}
+
+static void gen_label(const char *label) {
+    snprintf(gen(ML_LABEL, MI_NULL)->label, MAX_SYM_LEN * 2, "%s", label);
+}
+
+static void gen_frame(const char *callee, i32 dir) {
+    mline_t *ml = gen(ML_FRAME, MI_NULL);
+    ml->imm     = dir;
+    snprintf(ml->label, sizeof(ml->label), "%s", callee);
+}
+
+static void gen_note(IR_t *ir) {
+    gen(ML_NOTE, MI_NULL)->note = ir;
+}
+
+// bumps the `-instrument` counter named by `fmt`
+static void gen_counter(const char *fmt, u32 id) {
+    char str[MAX_SYM_LEN * 2];
+    snprintf(str, sizeof(str), fmt, cur_fun->str, id);
+    gen_la($t8, str);
+    gen_mem(MI_LW, $t9, 0, $t8);
+    gen_rri(MI_ADDI, $t9, $t9, 1);
+    gen_mem(MI_SW, $t9, 0, $t8);
+}
+
+static void emit_counter_words(ir_fun_t *prog) {
+    char str[MAX_SYM_LEN * 2];
+    emit(".data");
+    LIST_ITER(prog, fun) {
+        LIST_ITER(fun->instrs.head, it) {
+            if (ir_is_leader(it)) {
+                snprintf(str, sizeof(str), PROF_BLOCK_FMT ": .word 0", fun->str, it->id);
+                emit(str);
+            }
+            if (it->kind == IR_BRANCH) {
+                snprintf(str, sizeof(str), PROF_FALL_FMT ": .word 0", fun->str, it->id);
+                emit(str);
+            }
+        }
+    }
+}
+
+static ir_fun_t *get_fun(const char *str);
+
+// moves $sp past the frame of `callee`, `dir` -1 to enter and 1 to leave it
+static void emit_frame(const char *callee, i32 dir) {
+    if (templ) {
+        put_str(FRAME_MARK);
+        put_int(dir);
+        put_chr(' ');
+        emit(callee);
+    } else {
+        emit_sp(dir * (i32) get_fun(callee)->sf_size);
+    }
+}
+
+// copies `text` out up to each frame mark, which it fills in
+static void emit_template(const char *text) {
+    char callee[MAX_SYM_LEN];
+    i32  dir;
+    for (const char *p = text, *mark; *p;) {
+        if (!(mark = strstr(p, "\n" FRAME_MARK))) {
+            put_str(p);
+            break;
+        }
+        put(p, mark + 1 - p);
+        if (sscanf(mark + 1, FRAME_MARK "%d %63s", &dir, callee) == 2) {
+            emit_frame(callee, dir);
+        }
+        p = strchr(mark + 1, '\n');
+        p = p ? p + 1 : "";
+    }
+}
+
+// `ir` as a comment
+static void emit_note(IR_t *ir) {
+    fseek(note, 0, SEEK_SET);
+    ir_print(note, ir);
+    fflush(note);
+    put_chr('#');
+    put(note_buf, note_size);
+}
+
+static void print_line(const mline_t *ml) {
+    const char *op = MINST_NAMES[ml->kind];
+    switch (ml->line) {
+        case ML_LABEL: emit_label("", ml->label); return;
+        case ML_FRAME: emit_frame(ml->label, ml->imm); return;
+        case ML_NOTE: emit_note(ml->note); return;
+        case ML_DEAD: return;
+        case ML_INST: break;
+    }
+    switch (MINST_FMTS[ml->kind]) {
+        case MF_R3: emit_rrr(op, ml->rd, ml->rs, ml->rt); break;
+        case MF_RI: emit_rri(op, ml->rt, ml->rs, ml->imm); break;
+        case MF_LI: emit_li(ml->rt, ml->imm); break;
+        case MF_LA: emit_la(ml->rt, ml->label); break;
+        case MF_MEM: emit_mem(op, ml->rt, ml->imm, ml->rs); break;
+        case MF_BR: emit_branch(op, ml->rs, ml->rt, ml->label); break;
+        case MF_J: emit_jump(op, "", ml->label); break;
+        case MF_R2:
+            put_op(op);
+            put_str(REGS_NAMES[ml->rd]);
+            put(", ", 2);
+            put_str(REGS_NAMES[ml->rs]);
+            put_chr('\n');
+            break;
+        case MF_JR:
+            put_op(op);
+            put_str(REGS_NAMES[ml->rs]);
+            put_chr('\n');
+            break;
+        case MF_NONE: emit("  syscall"); break;
+        default: UNREACHABLE;
+    }
+}
+
+static void mips_gen_body(ir_fun_t *fun) {
+    emit_label("__fun__", fun->str);
     cur_fun = fun;
+    nline   = 0;
     LIST_ITER(fun->instrs.head, it) {
-        fprintf(fout, "#");
-        ir_print(fout, it);
+        if (flags.asm_ir) {
+            gen_note(it);
+        }
+        bool count = flags.instrument && ir_is_leader(it);
+        if (count && it->kind != IR_LABEL) {
+            gen_counter(PROF_BLOCK_FMT, it->id);
+        }
         VISITOR_DISPATCH(IR, mips_gen, it, NULL);
+        if (count && it->kind == IR_LABEL) {
+            gen_counter(PROF_BLOCK_FMT, it->id);
+        }
+        if (flags.instrument && it->kind == IR_BRANCH) {
+            gen_counter(PROF_FALL_FMT, it->id);
+        }
+    }
+    if (!flags.O0) {
+        BENCH("mips_peep", mips_peep(lines, nline));
+    }
+    for (u32 i = 0; i < nline; i++) {
+        print_line(&lines[i]);
+    }
+}
+
+static void mips_gen_fun(ir_fun_t *fun) {
+    if (!fun->cached && cache_enabled()) {
+        out_t *file = out, text = {.fd = -1};
+        out         = &text;
+        templ       = true;
+        mips_gen_body(fun);
+        put("", 1);
+        fun->asm_text = text.data;
+        out           = file;
+        templ         = false;
+    }
+    if (fun->asm_text) {
+        emit_template(fun->asm_text);
+    } else {
+        mips_gen_body(fun);
     }
 }
 
@@ -54,8 +424,17 @@ static ir_fun_t *get_fun(const char *str) {
 }
 
 void mips_gen(FILE *file, ir_fun_t *prog) {
-    fout = file;
-    LIST_FOREACH(prog, reg_alloc);
+    fflush(file);
+    out_t buf = {malloc(OUT_SIZE), 0, OUT_SIZE, fileno(file)};
+    out       = &buf;
+    if (flags.asm_ir) {
+        note = open_memstream(&note_buf, &note_size);
+    }
+    LIST_ITER(prog, fun) {
+        if (!fun->cached) {
+            BENCH("reg_alloc", reg_alloc(fun));
+        }
+    }
     emit(".data\n"
          "_prompt: .asciiz \"Enter an integer:\"\n"
          "_ret: .asciiz \"\\n\"\n"
@@ -77,7 +456,7 @@ void mips_gen(FILE *file, ir_fun_t *prog) {
          "  move $v0, $0\n"
          "  jr $ra\n"
          "main:\n");
-    emit_sp(-get_fun("main")->sf_size);
+    emit_sp(-(i32) get_fun("main")->sf_size);
     emit("  addi $sp, $sp, -4\n"
          "  sw $ra, 0($sp)\n"
          "  jal __fun__main\n"
@@ -87,16 +466,29 @@ void mips_gen(FILE *file, ir_fun_t *prog) {
     emit("  jr $ra\n");
 
     LIST_FOREACH(prog, mips_gen_fun);
+    if (flags.instrument) {
+        emit_counter_words(prog);
+    }
+    out_flush(&buf);
+    free(buf.data);
+    out = NULL;
+    free(lines);
+    lines    = NULL;
+    line_cap = 0;
+    if (flags.asm_ir) {
+        fclose(note);
+        free(note_buf);
+    }
 }
 
 static void load_oprd(const oprd_t *oprd, regs_t reg) {
     switch (oprd->kind) {
         case OPRD_VAR: {
-            emit("  lw %s, %d($sp)", REGS_NAMES[reg], cur_fun->sf_size - oprd->offset + 4);
+            gen_mem(MI_LW, reg, cur_fun->sf_size - oprd->offset + 4, $sp);
             break;
         }
         case OPRD_LIT: {
-            emit("  li %s, %d", REGS_NAMES[reg], oprd->val);
+            gen_li(reg, oprd->val);
             break;
         }
         default: UNREACHABLE;
@@ -105,11 +497,11 @@ static void load_oprd(const oprd_t *oprd, regs_t reg) {
 
 static void store_oprd(const oprd_t *oprd, regs_t reg) {
     ASSERT(oprd->kind == OPRD_VAR, "storing non var");
-    emit("  sw %s, %d($sp)\n", REGS_NAMES[reg], cur_fun->sf_size - oprd->offset + 4);
+    gen_mem(MI_SW, reg, cur_fun->sf_size - oprd->offset + 4, $sp);
 }
 
 VISIT(IR_LABEL) {
-    emit("%s:", node->str);
+    gen_label(node->str);
 }
 
 VISIT(IR_ASSIGN) {
@@ -120,129 +512,159 @@ VISIT(IR_ASSIGN) {
 VISIT(IR_BINARY) {
     load_oprd(&node->lhs, $t0);
     load_oprd(&node->rhs, $t1);
-    const char *op_str = NULL;
+    minst_kind_t op = MI_NULL;
     switch (node->op) {
         case OP_ADD: {
-            op_str = "add";
+            op = MI_ADD;
             break;
         }
         case OP_SUB: {
-            op_str = "sub";
+            op = MI_SUB;
             break;
         }
         case OP_MUL: {
-            op_str = "mul";
+            op = MI_MUL;
             break;
         }
         case OP_DIV: {
-            op_str = "div";
+            op = MI_DIV;
+            break;
+        }
+        // -setcc, 0 or 1 without branching
+        case OP_LT: {
+            gen_rrr(MI_SLT, $t2, $t0, $t1);
+            break;
+        }
+        case OP_GT: {
+            gen_rrr(MI_SLT, $t2, $t1, $t0);
+            break;
+        }
+        case OP_GE: {
+            gen_rrr(MI_SLT, $t2, $t0, $t1);
+            gen_rri(MI_XORI, $t2, $t2, 1);
+            break;
+        }
+        case OP_LE: {
+            gen_rrr(MI_SLT, $t2, $t1, $t0);
+            gen_rri(MI_XORI, $t2, $t2, 1);
+            break;
+        }
+        case OP_EQ: {
+            gen_rrr(MI_XOR, $t2, $t0, $t1);
+            gen_rri(MI_SLTIU, $t2, $t2, 1);
+            break;
+        }
+        case OP_NE: {
+            gen_rrr(MI_XOR, $t2, $t0, $t1);
+            gen_rrr(MI_SLTU, $t2, $zero, $t2);
             break;
         }
         default: UNREACHABLE;
     }
-    emit("  %s %s, %s, %s", op_str, REGS_NAMES[$t2], REGS_NAMES[$t0], REGS_NAMES[$t1]);
+    if (op != MI_NULL) {
+        gen_rrr(op, $t2, $t0, $t1);
+    }
     store_oprd(&node->tar, $t2);
 }
 
 VISIT(IR_DREF) {
-    emit("  addi $t0, $sp, %d", cur_fun->sf_size - node->lhs.offset + 4);
+    gen_rri(MI_ADDI, $t0, $sp, cur_fun->sf_size - node->lhs.offset + 4);
     store_oprd(&node->tar, $t0);
 }
 
 VISIT(IR_LOAD) {
     load_oprd(&node->lhs, $t0);
-    emit("  lw %s, 0(%s)\n", REGS_NAMES[$t1], REGS_NAMES[$t0]);
+    gen_mem(MI_LW, $t1, 0, $t0);
     store_oprd(&node->tar, $t1);
 }
 
 VISIT(IR_STORE) {
     load_oprd(&node->tar, $t0);
     load_oprd(&node->lhs, $t1);
-    emit("  sw %s, 0(%s)\n", REGS_NAMES[$t1], REGS_NAMES[$t0]);
+    gen_mem(MI_SW, $t1, 0, $t0);
 }
 
 VISIT(IR_GOTO) {
-    emit("  j %s", node->jmpto->str);
+    gen_jump(MI_J, "", node->jmpto->str);
 }
 
 VISIT(IR_BRANCH) {
     load_oprd(&node->lhs, $t0);
     load_oprd(&node->rhs, $t1);
-    const char *op_str = NULL;
+    minst_kind_t op = MI_NULL;
     switch (node->op) {
         case OP_EQ: {
-            op_str = "beq";
+            op = MI_BEQ;
             break;
         }
         case OP_NE: {
-            op_str = "bne";
+            op = MI_BNE;
             break;
         }
         case OP_LT: {
-            op_str = "blt";
+            op = MI_BLT;
             break;
         }
         case OP_GT: {
-            op_str = "bgt";
+            op = MI_BGT;
             break;
         }
         case OP_LE: {
-            op_str = "ble";
+            op = MI_BLE;
             break;
         }
         case OP_GE: {
-            op_str = "bge";
+            op = MI_BGE;
             break;
         }
         default: UNREACHABLE;
     }
-    emit("  %s %s, %s, %s", op_str, REGS_NAMES[$t0], REGS_NAMES[$t1], node->jmpto->str);
+    gen_branch(op, $t0, $t1, node->jmpto->str);
 }
 
 VISIT(IR_RETURN) {
     load_oprd(&node->lhs, $v0);
-    emit("  jr $ra");
+    gen_jr($ra);
 }
 
 VISIT(IR_ARG) {
     narg++;
     load_oprd(&node->lhs, $t0);
-    emit("  sw $t0, %d($sp)", -narg * 4);
+    gen_mem(MI_SW, $t0, -(i32) narg * 4, $sp);
 }
 
 VISIT(IR_CALL) {
     // args & locals
-    ir_fun_t *tar = get_fun(node->str);
-    emit_sp(-tar->sf_size);
+    gen_frame(node->str, -1);
 
-    emit("  addi $sp, $sp, -4");
-    emit("  sw $ra, 0($sp)");
-    emit("  jal __fun__%s", node->str);
-    emit("  lw $ra, 0($sp)");
-    emit("  addi $sp, $sp, 4");
+    gen_rri(MI_ADDI, $sp, $sp, -4);
+    gen_mem(MI_SW, $ra, 0, $sp);
+    gen_jump(MI_JAL, "__fun__", node->str);
+    gen_mem(MI_LW, $ra, 0, $sp);
+    gen_rri(MI_ADDI, $sp, $sp, 4);
 
     // locals
-    emit_sp(tar->sf_size);
+    gen_frame(node->str, 1);
     store_oprd(&node->tar, $v0);
     narg = 0;
 }
 
 VISIT(IR_READ) {
-    emit("  addi $sp, $sp, -4");
-    emit("  sw $ra, 0($sp)");
-    emit("  jal read");
-    emit("  lw $ra, 0($sp)");
-    emit("  addi $sp, $sp, 4");
+    gen_rri(MI_ADDI, $sp, $sp, -4);
+    gen_mem(MI_SW, $ra, 0, $sp);
+    gen_jump(MI_JAL, "", "read");
+    gen_mem(MI_LW, $ra, 0, $sp);
+    gen_rri(MI_ADDI, $sp, $sp, 4);
     store_oprd(&node->tar, $v0);
 }
 
 VISIT(IR_WRITE) {
     load_oprd(&node->lhs, $a0);
-    emit("  addi $sp, $sp, -4");
-    emit("  sw $ra, 0($sp)");
-    emit("  jal write");
-    emit("  lw $ra, 0($sp)");
-    emit("  addi $sp, $sp, 4");
+    gen_rri(MI_ADDI, $sp, $sp, -4);
+    gen_mem(MI_SW, $ra, 0, $sp);
+    gen_jump(MI_JAL, "", "write");
+    gen_mem(MI_LW, $ra, 0, $sp);
+    gen_rri(MI_ADDI, $sp, $sp, 4);
 }
 
 VISIT_EMPTY(IR_DEC);
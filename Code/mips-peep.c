@@ -0,0 +1,432 @@
+#include "mips-peep.h"
+#include <string.h>
+
+#define NREG 32
+#define BIT(REG) (1u << (REG))
+
+// registers `mips_gen` keeps nothing in from one IR instruction to the next
+#define SCRATCH                                                                                \
+    (BIT($at) | BIT($t0) | BIT($t1) | BIT($t2) | BIT($t3) | BIT($t4) | BIT($t5) | BIT($t6) | \
+     BIT($t7) | BIT($t8) | BIT($t9))
+
+#define MAX_ROUNDS 8
+
+static struct {
+    u64 loads;    // reloads turned into moves or dropped
+    u64 stores;   // stores of what the slot holds
+    u64 imms;     // constants folded into immediates
+    u64 sps;      // $sp adjustments that cancel out
+    u64 branches; // to the next line
+    u64 dead;     // results nobody reads
+} stat;
+
+// what is known about the registers at a point of a block
+typedef struct {
+    bool   held[NREG]; // equal to the word at `slot[reg]($sp)`
+    i32    slot[NREG];
+    bool   known[NREG]; // equal to `val[reg]`
+    i32    val[NREG];
+    regs_t copy[NREG]; // equal to `copy[reg]`, itself if nothing
+} facts_t;
+
+static bool fits_i16(i64 imm) {
+    return imm >= -32768 && imm < 32768;
+}
+
+static bool is_inst(const mline_t *ml, minst_kind_t kind) {
+    return ml->line == ML_INST && ml->kind == kind;
+}
+
+static bool is_jal(const mline_t *ml) {
+    return is_inst(ml, MI_JAL);
+}
+
+static bool is_sp_adjust(const mline_t *ml) {
+    return is_inst(ml, MI_ADDI) && ml->rt == $sp && ml->rs == $sp;
+}
+
+static void drop(mline_t *ml) {
+    ml->line = ML_DEAD;
+}
+
+// the operand fields `ml` reads, NULL ended
+static void use_fields(mline_t *ml, regs_t *fields[3]) {
+    u32 n = 0;
+    switch (MINST_FMTS[ml->kind]) {
+        case MF_R3:
+        case MF_BR:
+            fields[n++] = &ml->rs;
+            fields[n++] = &ml->rt;
+            break;
+        case MF_MEM:
+            fields[n++] = &ml->rs;
+            if (ml->kind == MI_SW) {
+                fields[n++] = &ml->rt;
+            }
+            break;
+        case MF_RI:
+        case MF_R2:
+        case MF_BRZ:
+        case MF_JR: fields[n++] = &ml->rs; break;
+        default: break;
+    }
+    fields[n] = NULL;
+}
+
+static u32 uses(const mline_t *ml) {
+    regs_t *fields[3];
+    u32     set = 0;
+    if (ml->kind == MI_SYSCALL) {
+        return BIT($v0) | BIT($a0);
+    }
+    if (is_jal(ml)) {
+        return ~SCRATCH;
+    }
+    use_fields((mline_t *) ml, fields);
+    for (regs_t **it = fields; *it; it++) {
+        set |= BIT(**it);
+    }
+    return set;
+}
+
+static u32 defs(const mline_t *ml) {
+    switch (MINST_FMTS[ml->kind]) {
+        case MF_R3:
+        case MF_R2: return BIT(ml->rd);
+        case MF_RI:
+        case MF_LI:
+        case MF_LA: return BIT(ml->rt);
+        case MF_MEM: return ml->kind == MI_LW ? BIT(ml->rt) : 0;
+        case MF_NONE: return BIT($v0);
+        case MF_J: return ml->kind == MI_JAL ? SCRATCH | BIT($v0) | BIT($ra) : 0;
+        default: return 0;
+    }
+}
+
+// no effect but its result, which may then go when unused
+static bool is_pure(const mline_t *ml) {
+    switch (MINST_FMTS[ml->kind]) {
+        case MF_R3: return ml->kind != MI_DIV;
+        case MF_RI:
+        case MF_LI:
+        case MF_LA:
+        case MF_R2: return true;
+        case MF_MEM: return ml->kind == MI_LW && ml->rs == $sp;
+        default: return false;
+    }
+}
+
+static void facts_reset(facts_t *facts) {
+    memset(facts, 0, sizeof(facts_t));
+    for (u32 i = 0; i < NREG; i++) {
+        facts->copy[i] = i;
+    }
+    facts->known[$zero] = true;
+}
+
+static void facts_kill(facts_t *facts, regs_t reg) {
+    facts->held[reg]  = false;
+    facts->known[reg] = false;
+    facts->copy[reg]  = reg;
+    for (u32 i = 0; i < NREG; i++) {
+        if (facts->copy[i] == reg) {
+            facts->copy[i] = i;
+        }
+    }
+}
+
+static void facts_forget(facts_t *facts, bool all, i32 slot) {
+    for (u32 i = 0; i < NREG; i++) {
+        if (all || facts->slot[i] == slot) {
+            facts->held[i] = false;
+        }
+    }
+}
+
+// a register equal to the word at `slot($sp)`, or -1
+static i32 facts_holder(const facts_t *facts, i32 slot) {
+    for (u32 i = 0; i < NREG; i++) {
+        if (facts->held[i] && facts->slot[i] == slot) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// rewrites `ml` with what `facts` know, then learns its effect on them
+static u32 forward_inst(facts_t *facts, mline_t *ml) {
+    u32     changes = 0;
+    regs_t *fields[3];
+    if (ml->kind != MI_SYSCALL) {
+        use_fields(ml, fields);
+        for (regs_t **it = fields; *it; it++) {
+            regs_t reg = facts->copy[**it];
+            if (facts->known[reg] && facts->val[reg] == 0) {
+                reg = $zero;
+            }
+            changes += reg != **it;
+            **it = reg;
+        }
+    }
+
+    switch (ml->kind) {
+        case MI_LI:
+            if (facts->known[ml->rt] && facts->val[ml->rt] == ml->imm) {
+                drop(ml);
+                stat.dead++;
+                return changes + 1;
+            }
+            break;
+        case MI_ADD:
+        case MI_SUB: {
+            bool lhs = facts->known[ml->rs], rhs = facts->known[ml->rt];
+            i64  l = facts->val[ml->rs], r = facts->val[ml->rt];
+            i64  val = ml->kind == MI_ADD ? l + r : l - r;
+            if (lhs && rhs && val == (i32) val) {
+                *ml = (mline_t){.line = ML_INST, .kind = MI_LI, .rt = ml->rd, .imm = val};
+            } else if (rhs && fits_i16(ml->kind == MI_ADD ? r : -r)) {
+                *ml = (mline_t){ML_INST, MI_ADDI, .rt = ml->rd, .rs = ml->rs, .imm = ml->kind == MI_ADD ? r : -r};
+            } else if (lhs && ml->kind == MI_ADD && fits_i16(l)) {
+                *ml = (mline_t){ML_INST, MI_ADDI, .rt = ml->rd, .rs = ml->rt, .imm = l};
+            } else {
+                break;
+            }
+            stat.imms++;
+            changes++;
+            break;
+        }
+        case MI_LW: {
+            i32 holder = ml->rs == $sp ? facts_holder(facts, ml->imm) : -1;
+            if (holder == (i32) ml->rt) {
+                drop(ml);
+                stat.loads++;
+                return changes + 1;
+            } else if (holder >= 0) {
+                i32    slot = ml->imm;
+                regs_t src  = facts->copy[holder];
+                *ml         = (mline_t){ML_INST, MI_MOVE, .rd = ml->rt, .rs = src};
+                stat.loads++;
+                changes++;
+                facts_kill(facts, ml->rd);
+                facts->copy[ml->rd]  = src;
+                facts->known[ml->rd] = facts->known[holder];
+                facts->val[ml->rd]   = facts->val[holder];
+                facts->held[ml->rd]  = true;
+                facts->slot[ml->rd]  = slot;
+                return changes;
+            }
+            break;
+        }
+        case MI_SW:
+            if (ml->rs == $sp && facts->held[ml->rt] && facts->slot[ml->rt] == ml->imm) {
+                drop(ml);
+                stat.stores++;
+                return changes + 1;
+            }
+            break;
+        case MI_MOVE:
+            if (ml->rd == ml->rs) {
+                drop(ml);
+                stat.dead++;
+                return changes + 1;
+            }
+            break;
+        default: break;
+    }
+
+    switch (ml->kind) {
+        case MI_LW:
+            facts_kill(facts, ml->rt);
+            if (ml->rs == $sp) {
+                facts->held[ml->rt] = true;
+                facts->slot[ml->rt] = ml->imm;
+            }
+            break;
+        case MI_SW:
+            facts_forget(facts, ml->rs != $sp, ml->imm);
+            if (ml->rs == $sp) {
+                facts->held[ml->rt] = true;
+                facts->slot[ml->rt] = ml->imm;
+            }
+            break;
+        case MI_MOVE: {
+            regs_t src = ml->rs;
+            facts_kill(facts, ml->rd);
+            facts->copy[ml->rd]  = src;
+            facts->known[ml->rd] = facts->known[src];
+            facts->val[ml->rd]   = facts->val[src];
+            facts->held[ml->rd]  = facts->held[src];
+            facts->slot[ml->rd]  = facts->slot[src];
+            break;
+        }
+        case MI_LI:
+            facts_kill(facts, ml->rt);
+            facts->known[ml->rt] = true;
+            facts->val[ml->rt]   = ml->imm;
+            break;
+        case MI_JAL:
+        case MI_J:
+        case MI_JR: facts_reset(facts); break;
+        default: {
+            u32 set = defs(ml);
+            for (u32 i = 1; i < NREG; i++) {
+                if (set & BIT(i)) {
+                    facts_kill(facts, i);
+                }
+            }
+            if (set & BIT($sp)) {
+                facts_forget(facts, true, 0);
+            }
+        }
+    }
+    return changes;
+}
+
+// copies, constants and stack slots along each block
+static u32 forward(mline_t *lines, u32 len) {
+    facts_t facts;
+    u32     changes = 0;
+    facts_reset(&facts);
+    for (u32 i = 0; i < len; i++) {
+        switch (lines[i].line) {
+            case ML_INST: changes += forward_inst(&facts, &lines[i]); break;
+            case ML_LABEL:
+            case ML_FRAME: facts_reset(&facts); break;
+            default: break;
+        }
+    }
+    return changes;
+}
+
+// `ml` still right with $sp `delta` bytes lower than it was written for
+static bool sp_movable(const mline_t *ml, i32 delta) {
+    if (ml->line != ML_INST) {
+        return ml->line != ML_LABEL && ml->line != ML_FRAME;
+    }
+    switch (MINST_FMTS[ml->kind]) {
+        case MF_MEM:
+            if (ml->rs == $sp) {
+                return ml->rt != $sp && fits_i16((i64) ml->imm + delta);
+            }
+            break;
+        case MF_RI:
+            if (ml->rs == $sp) {
+                return (ml->kind == MI_ADDI || ml->kind == MI_ADDIU) && ml->rt != $sp &&
+                       fits_i16((i64) ml->imm + delta);
+            }
+            break;
+        case MF_BR:
+        case MF_BRZ:
+        case MF_J:
+        case MF_JR:
+        case MF_NONE: return false;
+        default: break;
+    }
+    return !((uses(ml) | defs(ml)) & BIT($sp));
+}
+
+// sinks `addi $sp` into the next one of its block, if nothing between
+// minds, and drops them both when they cancel out
+static u32 sink_sp(mline_t *lines, u32 len) {
+    u32 changes = 0;
+    for (u32 i = 0; i < len; i++) {
+        if (!is_sp_adjust(&lines[i])) {
+            continue;
+        }
+        i32 delta = lines[i].imm;
+        u32 j     = i + 1;
+        while (j < len && !is_sp_adjust(&lines[j]) && sp_movable(&lines[j], delta)) {
+            j++;
+        }
+        if (j == len || !is_sp_adjust(&lines[j]) || !fits_i16((i64) lines[j].imm + delta)) {
+            continue;
+        }
+        for (u32 k = i + 1; k < j; k++) {
+            if (lines[k].line == ML_INST && lines[k].rs == $sp) {
+                lines[k].imm += delta;
+            }
+        }
+        drop(&lines[i]);
+        lines[j].imm += delta;
+        stat.sps++;
+        if (lines[j].imm == 0) {
+            drop(&lines[j]);
+            stat.sps++;
+        }
+        changes++;
+    }
+    return changes;
+}
+
+// branches whose target is among the labels right after them
+static u32 next_branch(mline_t *lines, u32 len) {
+    u32 changes = 0;
+    for (u32 i = 0; i < len; i++) {
+        mline_t *ml = &lines[i];
+        if (ml->line != ML_INST || is_jal(ml) ||
+            (MINST_FMTS[ml->kind] != MF_J && MINST_FMTS[ml->kind] != MF_BR && MINST_FMTS[ml->kind] != MF_BRZ)) {
+            continue;
+        }
+        for (u32 j = i + 1; j < len && lines[j].line != ML_INST && lines[j].line != ML_FRAME; j++) {
+            if (lines[j].line == ML_LABEL && !strcmp(lines[j].label, ml->label)) {
+                drop(ml);
+                stat.branches++;
+                changes++;
+                break;
+            }
+        }
+    }
+    return changes;
+}
+
+// results in scratch registers read by nothing
+static u32 dead(mline_t *lines, u32 len) {
+    u32 changes = 0, live = ~SCRATCH;
+    for (u32 i = len; i-- > 0;) {
+        mline_t *ml = &lines[i];
+        if (ml->line == ML_LABEL || ml->line == ML_FRAME) {
+            live = ~SCRATCH;
+        }
+        if (ml->line != ML_INST) {
+            continue;
+        }
+        u32 set = defs(ml);
+        if (is_pure(ml) && set && !(set & ~SCRATCH) && !(set & live)) {
+            drop(ml);
+            stat.dead++;
+            changes++;
+            continue;
+        }
+        switch (MINST_FMTS[ml->kind]) {
+            case MF_J:
+            case MF_JR: live = ~SCRATCH; break;
+            case MF_BR:
+            case MF_BRZ: live |= ~SCRATCH; break;
+            default: break;
+        }
+        live = (live & ~set) | uses(ml);
+    }
+    return changes;
+}
+
+void mips_peep(mline_t *lines, u32 len) {
+    for (u32 round = 0; round < MAX_ROUNDS; round++) {
+        u32 changes = 0;
+        changes += sink_sp(lines, len);
+        changes += forward(lines, len);
+        changes += next_branch(lines, len);
+        changes += dead(lines, len);
+        if (!changes) {
+            break;
+        }
+    }
+}
+
+void peep_stat_print(FILE *file) {
+    fprintf(file, "peep_loads\t%lu\n", stat.loads);
+    fprintf(file, "peep_stores\t%lu\n", stat.stores);
+    fprintf(file, "peep_imms\t%lu\n", stat.imms);
+    fprintf(file, "peep_sps\t%lu\n", stat.sps);
+    fprintf(file, "peep_branches\t%lu\n", stat.branches);
+    fprintf(file, "peep_dead\t%lu\n", stat.dead);
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "common.h"
+#include "ir.h"
+#include "mips-asm.h"
+
+/**
+ * A function body between the IR visitor of `mips_gen` and its text, one
+ * line at a time, so that the peephole pass can rewrite it in place. The
+ * operands of an instruction sit where minst_t has them.
+ */
+
+typedef enum {
+    ML_INST,
+    ML_LABEL,
+    ML_FRAME, // `emit_frame` of `label`, `imm` being the direction
+    ML_NOTE,  // `-asm-ir`
+    ML_DEAD,
+} mline_kind_t;
+
+typedef struct {
+    mline_kind_t line;
+    minst_kind_t kind;
+    regs_t       rd, rs, rt;
+    i32          imm;
+    IR_t        *note;
+    char         label[MAX_SYM_LEN * 2];
+} mline_t;
+
+// store-to-load forwarding, redundant loads and stores, constants folded
+// into immediates, cancelling $sp adjustments, branches to the next line
+// and dead scratch registers, until none applies
+void mips_peep(mline_t *lines, u32 len);
+
+// what `mips_peep` took out so far, on stderr with `-bench`
+void peep_stat_print(FILE *file);
@@ -38,10 +38,9 @@ static void alloc_with(oprd_t *oprd, u32 size) {
     }
     char oprd_str[SYM_STR_SIZE];
     symcpy(oprd_str, oprd_to_str(*oprd));
-    hashent_t *ent = hash_lookup(&hashtab, oprd_str);
+    hashent_t *ent = hash_insert(&hashtab, oprd_str);
     if (ent->ptr == NULL) {
         offset += size;
-        symcpy(ent->str, oprd_str);
         ent->ptr     = (void *) offset;
         oprd->offset = offset;
     } else {
@@ -54,7 +53,7 @@ static void alloc(oprd_t *oprd) {
 }
 
 void reg_alloc(ir_fun_t *fun) {
-    memset(&hashtab, 0, sizeof(hashtab));
+    hash_fini(&hashtab);
     offset = 0;
 
     LIST_REV_ITER(fun->instrs.tail, it) {
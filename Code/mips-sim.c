@@ -0,0 +1,273 @@
+#include "mips-sim.h"
+#include <stdarg.h>
+#include <string.h>
+
+#define STACK_TOP 0x80000000u
+#define STACK_SIZE (16u << 20)
+#define HALT_ADDR 0u
+
+typedef struct {
+    mips_prog  *prog;
+    u8         *stack;
+    u32         regs[32];
+    sim_stat_t *stat;
+    u32         lineno;
+} sim_t;
+
+static bool fault(sim_t *sim, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    fprintf(stderr, "sim: ");
+    vfprintf(stderr, fmt, ap);
+    fprintf(stderr, " at line %u\n", sim->lineno);
+    va_end(ap);
+    return false;
+}
+
+static u8 *mem_at(sim_t *sim, u32 addr, u32 size) {
+    mips_prog *prog = sim->prog;
+    if (addr >= MDATA_BASE && addr - MDATA_BASE + size <= prog->ndata) {
+        return prog->data + (addr - MDATA_BASE);
+    }
+    if (addr >= STACK_TOP - STACK_SIZE && addr <= STACK_TOP - size) {
+        return sim->stack + (addr - (STACK_TOP - STACK_SIZE));
+    }
+    return NULL;
+}
+
+static bool load_word(sim_t *sim, u32 addr, u32 *word) {
+    u8 *ptr = mem_at(sim, addr, 4);
+    if (!ptr || addr % 4 != 0) {
+        return fault(sim, "bad load from 0x%08x", addr);
+    }
+    memcpy(word, ptr, 4);
+    return true;
+}
+
+static bool store_word(sim_t *sim, u32 addr, u32 word) {
+    u8 *ptr = mem_at(sim, addr, 4);
+    if (!ptr || addr % 4 != 0) {
+        return fault(sim, "bad store to 0x%08x", addr);
+    }
+    memcpy(ptr, &word, 4);
+    return true;
+}
+
+static bool reads(const minst_t *inst, regs_t reg) {
+    switch (MINST_FMTS[inst->kind]) {
+        case MF_R3:
+        case MF_BR: return inst->rs == reg || inst->rt == reg;
+        case MF_MEM: return inst->rs == reg || (inst->kind == MI_SW && inst->rt == reg);
+        case MF_R2:
+        case MF_RI:
+        case MF_BRZ:
+        case MF_JR: return inst->rs == reg;
+        case MF_NONE: return reg == $v0 || reg == $a0;
+        default: return false;
+    }
+}
+
+static bool branch_taken(const minst_t *inst, i32 lhs, i32 rhs) {
+    switch (inst->kind) {
+        case MI_BEQ: return lhs == rhs;
+        case MI_BNE: return lhs != rhs;
+        case MI_BLT: return lhs < rhs;
+        case MI_BGT: return lhs > rhs;
+        case MI_BLE: return lhs <= rhs;
+        case MI_BGE: return lhs >= rhs;
+        case MI_BEQZ: return lhs == 0;
+        case MI_BNEZ: return lhs != 0;
+        default: UNREACHABLE;
+    }
+}
+
+static bool sim_syscall(sim_t *sim, FILE *in, FILE *out, bool *halt) {
+    u32 *regs = sim->regs;
+    switch (regs[$v0]) {
+        case 1: {
+            fprintf(out, "%d", (i32) regs[$a0]);
+            break;
+        }
+        case 4: {
+            for (u32 addr = regs[$a0];; addr++) {
+                u8 *ch = mem_at(sim, addr, 1);
+                if (!ch) {
+                    return fault(sim, "bad string at 0x%08x", regs[$a0]);
+                }
+                if (*ch == '\0') {
+                    break;
+                }
+                fputc(*ch, out);
+            }
+            break;
+        }
+        case 5: {
+            i32 val;
+            if (fscanf(in, "%d", &val) != 1) {
+                return fault(sim, "no integer to read");
+            }
+            regs[$v0] = (u32) val;
+            break;
+        }
+        case 10: {
+            *halt = true;
+            break;
+        }
+        case 11: {
+            fputc((char) regs[$a0], out);
+            break;
+        }
+        default: return fault(sim, "unknown syscall %u", regs[$v0]);
+    }
+    return true;
+}
+
+bool mips_sim(mips_prog *prog, FILE *in, FILE *out, u64 limit, sim_stat_t *stat) {
+    sim_t sim = {
+        .prog  = prog,
+        .stack = zalloc(STACK_SIZE),
+        .stat  = stat,
+    };
+    u32 *regs  = sim.regs;
+    regs[$sp]  = STACK_TOP - 4;
+    regs[$ra]  = HALT_ADDR;
+    bool ok    = true;
+    bool halt  = false;
+    i32  pc    = mips_text_index(prog, prog->entry);
+    i32  stall = -1; // register loaded by the previous instruction
+
+    for (u64 step = 1; ok && !halt; step++) {
+        if (pc < 0 || (u32) pc >= prog->ntext) {
+            ok = fault(&sim, "fell out of .text");
+            break;
+        }
+        if (limit && step > limit) {
+            ok = fault(&sim, "gave up after %lu instructions", limit);
+            break;
+        }
+        const minst_t *inst = &prog->text[pc++];
+        u32            rs = regs[inst->rs], rt = regs[inst->rt];
+        u32            res = 0;
+        regs_t         dst = $zero;
+
+        sim.lineno = inst->lineno;
+        stat->instrs += inst->width;
+        stat->cycles += inst->width;
+        if (stall >= 0 && reads(inst, stall)) {
+            stat->cycles++;
+        }
+        stall = -1;
+
+        switch (inst->kind) {
+            case MI_ADD:
+            case MI_ADDU: res = rs + rt, dst = inst->rd; break;
+            case MI_SUB:
+            case MI_SUBU: res = rs - rt, dst = inst->rd; break;
+            case MI_MUL: {
+                res = (u32) ((i64) (i32) rs * (i32) rt);
+                dst = inst->rd;
+                stat->cycles += SIM_MUL_CYCLES - 1;
+                break;
+            }
+            case MI_DIV: {
+                if (rt == 0) {
+                    ok = fault(&sim, "division by zero");
+                    break;
+                }
+                // INT_MIN / -1 wraps like the hardware does
+                res = (i32) rs == INT32_MIN && (i32) rt == -1 ? rs : (u32) ((i32) rs / (i32) rt);
+                dst = inst->rd;
+                stat->cycles += SIM_DIV_CYCLES - 1;
+                break;
+            }
+            case MI_AND: res = rs & rt, dst = inst->rd; break;
+            case MI_OR: res = rs | rt, dst = inst->rd; break;
+            case MI_XOR: res = rs ^ rt, dst = inst->rd; break;
+            case MI_SLT: res = (i32) rs < (i32) rt, dst = inst->rd; break;
+            case MI_SLTU: res = rs < rt, dst = inst->rd; break;
+            case MI_ADDI:
+            case MI_ADDIU: res = rs + (u32) inst->imm, dst = inst->rt; break;
+            case MI_ANDI: res = rs & (u32) inst->imm, dst = inst->rt; break;
+            case MI_ORI: res = rs | (u32) inst->imm, dst = inst->rt; break;
+            case MI_XORI: res = rs ^ (u32) inst->imm, dst = inst->rt; break;
+            case MI_SLTI: res = (i32) rs < inst->imm, dst = inst->rt; break;
+            case MI_SLTIU: res = rs < (u32) inst->imm, dst = inst->rt; break;
+            case MI_SLL: res = rs << (inst->imm & 31), dst = inst->rt; break;
+            case MI_SRA: res = (u32) ((i32) rs >> (inst->imm & 31)), dst = inst->rt; break;
+            case MI_LI: res = (u32) inst->imm, dst = inst->rt; break;
+            case MI_LUI: res = (u32) inst->imm << 16, dst = inst->rt; break;
+            case MI_LA: res = inst->target, dst = inst->rt; break;
+            case MI_MOVE: res = rs, dst = inst->rd; break;
+            case MI_LW: {
+                ok    = load_word(&sim, rs + (u32) inst->imm, &res);
+                dst   = inst->rt;
+                stall = inst->rt;
+                stat->loads++;
+                break;
+            }
+            case MI_SW: {
+                ok = store_word(&sim, rs + (u32) inst->imm, rt);
+                stat->stores++;
+                break;
+            }
+            case MI_BEQ:
+            case MI_BNE:
+            case MI_BLT:
+            case MI_BGT:
+            case MI_BLE:
+            case MI_BGE:
+            case MI_BEQZ:
+            case MI_BNEZ: {
+                stat->branches++;
+                if (branch_taken(inst, (i32) rs, (i32) rt)) {
+                    stat->taken++;
+                    stat->cycles++;
+                    pc = inst->tindex;
+                }
+                break;
+            }
+            case MI_JAL: {
+                res = inst->addr + 4 * inst->width;
+                dst = $ra;
+                stat->calls++;
+            }
+            // fall through
+            case MI_J: {
+                stat->cycles++;
+                pc = inst->tindex;
+                break;
+            }
+            case MI_JR: {
+                stat->cycles++;
+                if (rs == HALT_ADDR) {
+                    halt = true;
+                    break;
+                }
+                pc = mips_text_index(prog, rs);
+                break;
+            }
+            case MI_SYSCALL: {
+                stat->syscalls++;
+                ok = sim_syscall(&sim, in, out, &halt);
+                break;
+            }
+            default: UNREACHABLE;
+        }
+        if (dst != $zero) {
+            regs[dst] = res;
+        }
+    }
+    zfree(sim.stack);
+    return ok;
+}
+
+void sim_stat_print(FILE *file, const sim_stat_t *stat) {
+    fprintf(file, "instrs\t%lu\n", stat->instrs);
+    fprintf(file, "loads\t%lu\n", stat->loads);
+    fprintf(file, "stores\t%lu\n", stat->stores);
+    fprintf(file, "branches\t%lu\n", stat->branches);
+    fprintf(file, "taken\t%lu\n", stat->taken);
+    fprintf(file, "calls\t%lu\n", stat->calls);
+    fprintf(file, "syscalls\t%lu\n", stat->syscalls);
+    fprintf(file, "cycles\t%lu\n", stat->cycles);
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "common.h"
+#include "mips-asm.h"
+#include <stdbool.h>
+
+/**
+ * Dynamic counts of one simulated run. `instrs` counts machine
+ * instructions, pseudo ones expanded. `cycles` assumes a single issue
+ * 5-stage pipeline without delay slots: one cycle per instruction, plus
+ * one for a load used by the next instruction, one per taken branch or
+ * jump, and the multi-cycle latency of mul and div.
+ */
+typedef struct sim_stat_t {
+    u64 instrs;
+    u64 loads, stores;
+    u64 branches, taken;
+    u64 calls, syscalls;
+    u64 cycles;
+} sim_stat_t;
+
+#define SIM_MUL_CYCLES 4
+#define SIM_DIV_CYCLES 32
+
+/**
+ * Runs `prog` from `main` until it returns or exits, or for `limit`
+ * instructions unless it is 0. Syscalls read from `in` and write to
+ * `out`. The .data of `prog` is updated in place.
+ * Returns false, after reporting to stderr, on a runtime fault.
+ */
+bool mips_sim(mips_prog *prog, FILE *in, FILE *out, u64 limit, sim_stat_t *stat);
+
+void sim_stat_print(FILE *file, const sim_stat_t *stat);
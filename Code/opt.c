@@ -1,17 +1,69 @@
 #include "opt.h"
 #include "cfg.h"
+#include <string.h>
 
 #define NROUND 5
+#define MAX_PASSES 64
 
+CFG_OPT(OPT_REGISTER)
 CLEANUP_OPT(OPT_REGISTER)
 LOCAL_OPT(OPT_REGISTER)
 ONCE_OPT(OPT_REGISTER)
 
+typedef struct {
+    const char *name;
+    void (*run)(cfg_t *cfg);
+} pass_t;
+
+static const pass_t PASSES[] = {
+    CFG_OPT(OPT_ENTRY)
+    LOCAL_OPT(OPT_ENTRY)
+    CLEANUP_OPT(OPT_ENTRY)
+    ONCE_OPT(OPT_ENTRY)};
+
+// `-passes`, NULL for the usual pipeline
+static const pass_t *selected[MAX_PASSES + 1];
+
+bool opt_select(const char *passes) {
+    u32 n = 0;
+    for (const char *p = passes; *p;) {
+        const char *end = strchr(p, ',');
+        u32         len = end ? (u32) (end - p) : strlen(p);
+        if (len > 3 && !strncmp(p, "do_", 3)) {
+            p += 3, len -= 3;
+        }
+        const pass_t *pass = NULL;
+        for (u32 i = 0; i < ARR_LEN(PASSES); i++) {
+            if (strlen(PASSES[i].name) == len && !strncmp(PASSES[i].name, p, len)) {
+                pass = &PASSES[i];
+            }
+        }
+        if (pass == NULL || n == MAX_PASSES) {
+            fprintf(stderr, "-passes: cannot run %.*s\n", (i32) len, p);
+            return false;
+        }
+        selected[n++] = pass;
+        p += end ? len + 1 : len;
+    }
+    selected[n] = NULL;
+    return true;
+}
+
 void optimize(cfg_t *cfg) {
     LOG("optimize %s", cfg->str);
+    if (flags.passes) {
+        for (const pass_t **pass = selected; *pass; pass++) {
+            BENCH((*pass)->name, (*pass)->run(cfg));
+        }
+        return;
+    }
+    CFG_OPT(OPT_EXECUTE)
     LOCAL_OPT(OPT_EXECUTE)
     CLEANUP_OPT(OPT_EXECUTE)
+    CFG_OPT(OPT_EXECUTE)
     ONCE_OPT(OPT_EXECUTE)
+    CFG_OPT(OPT_EXECUTE)
     LOCAL_OPT(OPT_EXECUTE)
     CLEANUP_OPT(OPT_EXECUTE)
+    CFG_OPT(OPT_EXECUTE)
 }
\ No newline at end of file
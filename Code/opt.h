@@ -1,21 +1,36 @@
 #pragma once
 #include "cfg.h"
 #include "ir.h"
+#include "bench.h"
+
+// reshapes the CFG, between the others
+#define CFG_OPT(F) \
+    F(clean)
 
 #define LOCAL_OPT(F) \
     F(lvn)
 
 #define CLEANUP_OPT(F) \
     F(cp_rewrite)      \
+    F(mem)             \
     F(strength)        \
+    F(fuse)            \
+    F(adce)            \
     F(dce)
 
 #define ONCE_OPT(F) \
+    F(sroa)         \
     F(copy_rewrite) \
     F(licm)         \
-    F(simpl)
+    F(simpl)        \
+    F(thread)
 
 #define OPT_REGISTER(OPT) extern void do_##OPT(cfg_t *cfg);
-#define OPT_EXECUTE(OPT) do_##OPT(cfg);
+#define OPT_EXECUTE(OPT) BENCH(STRINGIFY(OPT), do_##OPT(cfg));
+#define OPT_ENTRY(OPT) {STRINGIFY(OPT), do_##OPT},
+
+void optimize(cfg_t *cfg);
 
-void optimize(cfg_t *cfg);
\ No newline at end of file
+// runs the comma separated `passes` in place of the usual ones, false after
+// reporting an unknown one
+bool opt_select(const char *passes);
\ No newline at end of file
@@ -0,0 +1,186 @@
+#include "profile.h"
+#include "symtab.h"
+#include <string.h>
+
+#define NOT_EDGE ((u32) -1)
+#define MAX_LINE 256
+
+typedef struct {
+    char fun[MAX_SYM_LEN];
+    u32  from, to; // `to` is NOT_EDGE for blocks
+    u64  count;
+} prof_ent_t;
+
+static prof_ent_t *ents;
+static u32         nent, cap_ent;
+static bool        loaded;
+
+static i32 ent_cmp(const void *lhs, const void *rhs) {
+    const prof_ent_t *l = lhs, *r = rhs;
+    i32               c = strcmp(l->fun, r->fun);
+    if (c != 0) {
+        return c;
+    }
+    if (l->from != r->from) {
+        return l->from < r->from ? -1 : 1;
+    }
+    if (l->to != r->to) {
+        return l->to < r->to ? -1 : 1;
+    }
+    return 0;
+}
+
+static void ent_add(const char *fun, u32 from, u32 to, u64 count) {
+    if (nent == cap_ent) {
+        cap_ent = cap_ent ? cap_ent * 2 : 256;
+        ents    = realloc(ents, sizeof(prof_ent_t) * cap_ent);
+    }
+    prof_ent_t *ent = &ents[nent++];
+    symcpy(ent->fun, fun);
+    ent->from  = from;
+    ent->to    = to;
+    ent->count = count;
+}
+
+bool profile_load(const char *fname) {
+    char line[MAX_LINE], fun[MAX_SYM_LEN];
+    u32  from, to, lineno = 0;
+    u64  count;
+    bool ok = false;
+
+    profile_unload();
+    FOPEN(fname, file, "r") {
+        ok = true;
+        while (ok && fgets(line, sizeof(line), file)) {
+            lineno++;
+            if (line[0] == '#' || line[0] == '\n') {
+                continue;
+            }
+            if (sscanf(line, "block %63s %u %lu", fun, &from, &count) == 3) {
+                ent_add(fun, from, NOT_EDGE, count);
+            } else if (sscanf(line, "edge %63s %u %u %lu", fun, &from, &to, &count) == 4) {
+                ent_add(fun, from, to, count);
+            } else {
+                fprintf(stderr, "%s:%u: bad profile line\n", fname, lineno);
+                ok = false;
+            }
+        }
+    }
+    if (!ok) {
+        if (lineno == 0) {
+            perror(fname);
+        }
+        profile_unload();
+        return false;
+    }
+
+    // profiles of several runs may be concatenated
+    qsort(ents, nent, sizeof(prof_ent_t), ent_cmp);
+    u32 n = 0;
+    for (u32 i = 0; i < nent; i++) {
+        if (n != 0 && ent_cmp(&ents[n - 1], &ents[i]) == 0) {
+            ents[n - 1].count += ents[i].count;
+        } else {
+            ents[n++] = ents[i];
+        }
+    }
+    nent   = n;
+    loaded = true;
+    return true;
+}
+
+void profile_unload() {
+    free(ents);
+    ents    = NULL;
+    nent    = 0;
+    cap_ent = 0;
+    loaded  = false;
+}
+
+bool profile_loaded() {
+    return loaded;
+}
+
+static i64 lookup(const char *fun, u32 from, u32 to) {
+    prof_ent_t key = {.from = from, .to = to};
+    symcpy(key.fun, fun);
+    prof_ent_t *ent = bsearch(&key, ents, nent, sizeof(prof_ent_t), ent_cmp);
+    return ent ? (i64) ent->count : PROF_UNKNOWN;
+}
+
+i64 profile_block(const char *fun, u32 leader) {
+    return lookup(fun, leader, NOT_EDGE);
+}
+
+i64 profile_edge(const char *fun, u32 from, u32 to) {
+    return lookup(fun, from, to);
+}
+
+u64 profile_digest(const char *fun, u64 hash) {
+    for (u32 i = 0; i < nent; i++) {
+        if (!strcmp(ents[i].fun, fun)) {
+            hash = fnv(hash, &ents[i].from, sizeof(u32));
+            hash = fnv(hash, &ents[i].to, sizeof(u32));
+            hash = fnv(hash, &ents[i].count, sizeof(u64));
+        }
+    }
+    return hash;
+}
+
+i64 block_count(const cfg_t *cfg, const block_t *blk) {
+    if (!loaded || blk->instrs.head == NULL) {
+        return PROF_UNKNOWN;
+    }
+    return profile_block(cfg->str, blk->instrs.head->id);
+}
+
+i64 edge_count(const cfg_t *cfg, const edge_t *edge) {
+    if (!loaded || edge->from->instrs.head == NULL || edge->to->instrs.head == NULL) {
+        return PROF_UNKNOWN;
+    }
+    return profile_edge(cfg->str, edge->from->instrs.head->id, edge->to->instrs.head->id);
+}
+
+static u64 counter(const mips_prog *mprog, const char *fmt, const char *fun, u32 id) {
+    char str[MAX_SYM_LEN * 2];
+    snprintf(str, sizeof(str), fmt, fun, id);
+    const mlabel_t *label = mips_label(mprog, str);
+    if (!label || label->text || label->addr - MDATA_BASE + 4 > mprog->ndata) {
+        return 0;
+    }
+    u32 word;
+    memcpy(&word, mprog->data + (label->addr - MDATA_BASE), 4);
+    return word;
+}
+
+void profile_dump_counters(FILE *file, ir_fun_t *prog, const mips_prog *mprog) {
+    fprintf(file, "# block <fun> <leader-id> <count>\n");
+    fprintf(file, "# edge <fun> <from-leader-id> <to-leader-id> <count>\n");
+    LIST_ITER(prog, fun) {
+        const char *str    = fun->str;
+        IR_t       *leader = NULL;
+        u64         count  = 0;
+        LIST_ITER(fun->instrs.head, it) {
+            if (ir_is_leader(it)) {
+                leader = it;
+                count  = counter(mprog, PROF_BLOCK_FMT, str, it->id);
+                fprintf(file, "block %s %u %lu\n", str, it->id, count);
+            }
+            if (it->next && !ir_is_leader(it->next)) {
+                continue;
+            }
+            u64 fall = count;
+            if (it->kind == IR_GOTO) {
+                fall = 0;
+            } else if (it->kind == IR_BRANCH) {
+                fall = counter(mprog, PROF_FALL_FMT, str, it->id);
+            }
+            if (it->kind == IR_GOTO || it->kind == IR_BRANCH) {
+                fprintf(file, "edge %s %u %u %lu\n", str, leader->id, it->jmpto->id, count - fall);
+            }
+            if (it->kind != IR_GOTO && it->kind != IR_RETURN && it->next) {
+                fprintf(file, "edge %s %u %u %lu\n", str, leader->id, it->next->id, fall);
+            }
+        }
+    }
+}
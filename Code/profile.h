@@ -0,0 +1,45 @@
+#pragma once
+#include "common.h"
+#include "cfg.h"
+#include "ir.h"
+#include "mips-asm.h"
+#include <stdbool.h>
+
+/**
+ * Block and edge counts from a profiling run, in the format of
+ * `interp_prof_dump`. Blocks are keyed by function name and the IR id
+ * of their first instruction, which `ir_renumber` counts within the
+ * function, so it is stable between compiles of the same function with
+ * the same options.
+ */
+
+#define PROF_UNKNOWN (-1)
+
+// false, after reporting to stderr, if `fname` cannot be read
+bool profile_load(const char *fname);
+
+void profile_unload();
+
+bool profile_loaded();
+
+i64 profile_block(const char *fun, u32 leader);
+
+i64 profile_edge(const char *fun, u32 from, u32 to);
+
+// folds the counts of `fun` into `hash`
+u64 profile_digest(const char *fun, u64 hash);
+
+// shorthands for the CFG of `cfg`, PROF_UNKNOWN for blocks without instructions
+i64 block_count(const cfg_t *cfg, const block_t *blk);
+
+i64 edge_count(const cfg_t *cfg, const edge_t *edge);
+
+/**
+ * `-instrument` makes `mips_gen` count every block and every fall
+ * through out of a branch in `.data` words, named by these.
+ */
+#define PROF_BLOCK_FMT "_prof.%s.%u"
+#define PROF_FALL_FMT "_prof.%s.f%u"
+
+// writes the profile of `prog` from the counters of a simulated run
+void profile_dump_counters(FILE *file, ir_fun_t *prog, const mips_prog *mprog);
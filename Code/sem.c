@@ -8,12 +8,11 @@
 #include <stdbool.h>
 #include <stdio.h>
 
-#define RET_TYPE type_t *
+#define RET_TYPE const type_t **
 #define ARG typ
 VISITOR_DEF(AST, sem, RET_TYPE);
 
-extern bool   sem_err;
-extern type_t type_int, type_flt, type_err;
+extern bool sem_err;
 
 // no nested functions, a pointer is sufficient
 static syment_t *cur_fun;
@@ -21,11 +20,11 @@ static syment_t *cur_fun;
 // do not insert fields into symtab
 static u32 nested_struct = 0;
 
-type_t ast_check(AST_t *node) {
+const type_t *ast_check(AST_t *node) {
     if (node == NULL) {
-        return type_err;
+        return &type_err;
     }
-    type_t ARG = {0};
+    const type_t *ARG = &type_null;
     VISITOR_DISPATCH(AST, sem, node, &ARG);
     return node->type = ARG;
 }
@@ -48,7 +47,7 @@ VISIT(STMT_SCOP) {
 }
 
 VISIT(STMT_IFTE) {
-    type_t cond_typ = ast_check(node->cond);
+    const type_t *cond_typ = ast_check(node->cond);
     if (!IS_LOGIC(cond_typ)) {
         SEM_ERR_RETURN(ERR_COND_TYPE, node->cond->fst_l);
     }
@@ -57,7 +56,7 @@ VISIT(STMT_IFTE) {
 }
 
 VISIT(STMT_WHLE) {
-    type_t cond_typ = ast_check(node->cond);
+    const type_t *cond_typ = ast_check(node->cond);
     if (!IS_LOGIC(cond_typ)) {
         SEM_ERR_RETURN(ERR_COND_TYPE, node->cond->fst_l);
     }
@@ -65,7 +64,7 @@ VISIT(STMT_WHLE) {
 }
 
 VISIT(STMT_RET) {
-    type_t expr_typ = ast_check(node->expr);
+    const type_t *expr_typ = ast_check(node->expr);
     if (!type_eq(expr_typ, cur_fun->typ)) {
         SEM_ERR_RETURN(ERR_RET_MISMATCH, node->expr->fst_l);
     }
@@ -86,7 +85,7 @@ VISIT(EXPR_CALL) {
 
     syment_t *sit = sym->params;
     LIST_ITER(node->expr, nit) {
-        type_t arg_typ = ast_check(nit);
+        const type_t *arg_typ = ast_check(nit);
         if (!type_eq(arg_typ, sit->typ)) {
             SEM_ERR_RETURN(ERR_FUN_ARG_MISMATCH, nit->fst_l, node->str);
         }
@@ -105,34 +104,33 @@ VISIT(EXPR_IDEN) {
 }
 
 VISIT(EXPR_ARR) {
-    type_t arr_typ = ast_check(node->arr);
-    u32    len     = 0;
-    bool   err     = false;
-    if (arr_typ.kind != TYPE_ARRAY) {
+    const type_t *arr_typ = ast_check(node->arr);
+    u32           len     = 0;
+    bool          err     = false;
+    if (arr_typ->kind != TYPE_ARRAY) {
         SEM_ERR(ERR_ACC_NON_ARRAY, node->arr->fst_l);
         err = true;
     }
     LIST_ITER(node->ind, it) {
         len++;
-        type_t ind_typ = ast_check(it);
+        const type_t *ind_typ = ast_check(it);
         if (!IS_LOGIC(ind_typ)) {
             SEM_ERR(ERR_ACC_INDEX, it->fst_l);
             err = true;
         }
     }
     if (err) {
-        RETURN(type_err);
+        RETURN(&type_err);
     }
-    if (len != arr_typ.dim) {
-        arr_typ.dim -= len;
-        RETURN(arr_typ);
+    if (len < arr_typ->dim) {
+        RETURN(type_array(arr_typ->elem_typ, arr_typ->dim - len, arr_typ->len));
     }
-    RETURN(*arr_typ.elem_typ);
+    RETURN(arr_typ->elem_typ);
 }
 
 VISIT(EXPR_ASS) {
-    type_t ltyp = ast_check(node->lhs);
-    type_t rtyp = ast_check(node->rhs);
+    const type_t *ltyp = ast_check(node->lhs);
+    const type_t *rtyp = ast_check(node->rhs);
     if (!type_eq(ltyp, rtyp)) {
         SEM_ERR_RETURN(ERR_ASS_MISMATCH, node->super.fst_l);
     }
@@ -143,11 +141,11 @@ VISIT(EXPR_ASS) {
 }
 
 VISIT(EXPR_DOT) {
-    type_t base_typ = ast_check(node->base);
-    if (base_typ.kind != TYPE_STRUCT) {
+    const type_t *base_typ = ast_check(node->base);
+    if (base_typ->kind != TYPE_STRUCT) {
         SEM_ERR_RETURN(ERR_ACC_NON_STRUCT, node->base->fst_l);
     }
-    LIST_ITER(base_typ.fields, it) {
+    LIST_ITER(base_typ->fields, it) {
         if (!symcmp(it->str, node->str)) {
             node->field = it;
             node->typ   = it->typ;
@@ -158,14 +156,14 @@ VISIT(EXPR_DOT) {
 }
 
 VISIT(EXPR_INT) {
-    RETURN(type_int);
+    RETURN(&type_int);
 }
 
 VISIT(EXPR_FLT) {
-    RETURN(type_flt);
+    RETURN(&type_flt);
 }
 
-static void logic_check(op_kind_t op, type_t typ) {
+static void logic_check(op_kind_t op, const type_t *typ) {
     switch (op) {
         LOGIC_OPS(CASE) {
             if (!IS_LOGIC(typ)) {
@@ -178,8 +176,8 @@ static void logic_check(op_kind_t op, type_t typ) {
 }
 
 VISIT(EXPR_BIN) {
-    type_t ltyp = ast_check(node->lhs);
-    type_t rtyp = ast_check(node->rhs);
+    const type_t *ltyp = ast_check(node->lhs);
+    const type_t *rtyp = ast_check(node->rhs);
 
     if (!IS_SCALAR(ltyp)) {
         SEM_ERR_RETURN(ERR_EXP_OPERAND_MISMATCH, node->super.fst_l);
@@ -192,7 +190,7 @@ VISIT(EXPR_BIN) {
 }
 
 VISIT(EXPR_UNR) {
-    type_t styp = ast_check(node->sub);
+    const type_t *styp = ast_check(node->sub);
     if (!IS_SCALAR(styp)) {
         SEM_ERR_RETURN(ERR_EXP_OPERAND_MISMATCH, node->super.fst_l);
     }
@@ -201,20 +199,13 @@ VISIT(EXPR_UNR) {
 }
 
 VISIT(DECL_VAR) {
-    type_t spec_typ = ast_check(node->spec);
-    type_t var_typ  = spec_typ;
+    const type_t *spec_typ = ast_check(node->spec);
+    const type_t *var_typ  = spec_typ;
     if (node->dim != 0) {
-        var_typ = (type_t){
-            .dim      = node->dim,
-            .kind     = TYPE_ARRAY,
-            .elem_typ = zalloc(sizeof(type_t)),
-            .is_ref   = false};
-        *var_typ.elem_typ = spec_typ;
-        memcpy(var_typ.len, node->len, node->dim * sizeof(var_typ.len[0]));
-        var_typ.size = typ_set_size(&var_typ);
+        var_typ = type_array(spec_typ, node->dim, node->len);
     }
     if (node->expr != NULL) {
-        type_t expr_typ = ast_check(node->expr);
+        const type_t *expr_typ = ast_check(node->expr);
         if (nested_struct) {
             SEM_ERR(ERR_FIELD_REDEF, node->expr->fst_l, node->str);
         } else if (!type_eq(var_typ, expr_typ)) {
@@ -226,7 +217,6 @@ VISIT(DECL_VAR) {
             node->str,
             SYM_VAR);
         if (!sym) {
-            typ_free(var_typ);
             SEM_ERR_RETURN(ERR_VAR_REDEF, node->super.fst_l, node->str);
         }
         sym->typ  = var_typ;
@@ -243,7 +233,7 @@ VISIT(DECL_TYP) {
 static void check_params(AST_t *params, syment_t *sym_params, u32 fst_l, const char *str, bool err) {
     syment_t *jt = sym_params;
     LIST_ITER(params, it) {
-        type_t param_typ = ast_check(it);
+        const type_t *param_typ = ast_check(it);
         if (!err && !type_eq(param_typ, jt->typ)) {
             SEM_ERR(ERR_FUN_DEC_COLLISION, fst_l, str);
             err = true;
@@ -255,8 +245,8 @@ static void check_params(AST_t *params, syment_t *sym_params, u32 fst_l, const c
 }
 
 VISIT(CONS_FUN) {
-    type_t    ret_typ = ast_check(node->spec);
-    syment_t *sym     = sym_insert(node->str, SYM_FUN);
+    const type_t *ret_typ = ast_check(node->spec);
+    syment_t     *sym     = sym_insert(node->str, SYM_FUN);
 
     if (sym != NULL) {
         sym->typ = ret_typ;
@@ -310,9 +300,9 @@ VISIT(CONS_FUN) {
 
 VISIT(CONS_SPEC) {
     if (node->kind == TYPE_PRIM_INT) {
-        RETURN(type_int);
+        RETURN(&type_int);
     } else if (node->kind == TYPE_PRIM_FLT) {
-        RETURN(type_flt);
+        RETURN(&type_flt);
     } else if (node->done) {
         RETURN(sym_lookup(node->str)->typ);
     }
@@ -325,15 +315,11 @@ VISIT(CONS_SPEC) {
         if (sym->kind != SYM_TYP) {
             SEM_ERR_RETURN(ERR_STRUCT_UNDEF, node->super.fst_l, node->str);
         }
-        *typ        = sym->typ;
-        typ->is_ref = true;
-        RETURN(*typ);
+        RETURN(sym->typ);
     }
 
-    symcpy(typ->str, node->str);
-    typ->kind   = node->kind;
-    typ->fields = NULL;
-    bool err    = false;
+    field_t *fields = NULL;
+    bool     err    = false;
 
     syment_t *sym = sym_lookup(node->str);
     if (sym != NULL) {
@@ -345,14 +331,13 @@ VISIT(CONS_SPEC) {
         INSTANCE_OF(it, DECL_VAR) {
             nested_struct++;
             // ast_check(spec var) -> typeof(spec)
-            type_t field_typ = ast_check(it);
+            const type_t *field_typ = ast_check(it);
             nested_struct--;
 
-            if (field_exist(typ->fields, cnode->str)) {
-                typ_free(field_typ);
+            if (field_exist(fields, cnode->str)) {
                 SEM_ERR(ERR_FIELD_REDEF, cnode->super.fst_l, cnode->str);
-            } else if (!err && field_typ.kind != TYPE_ERR) {
-                LIST_APPEND(typ->fields, field_alloc(field_typ, cnode->str));
+            } else if (!err && field_typ->kind != TYPE_ERR) {
+                LIST_APPEND(fields, field_alloc(field_typ, cnode->str));
             }
         }
     }
@@ -362,9 +347,12 @@ VISIT(CONS_SPEC) {
         err = true;
     }
     if (err) {
-        RETURN(type_err);
+        field_free(fields);
+        if (sym != NULL) {
+            sym->typ = &type_null;
+        }
+        RETURN(&type_err);
     }
-    typ->size = typ_set_size(typ);
-    sym->typ  = *typ;
-    RETURN(*typ);
+    sym->typ = type_struct(node->str, fields);
+    RETURN(sym->typ);
 }
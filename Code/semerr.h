@@ -57,10 +57,10 @@ static const char *SEM_ERR_MSG[] = {
     "Condition type error",
     "\0"};
 
-#define SEM_ERR_RETURN(...)                 \
-    do {                                    \
-        SEM_ERR(__VA_ARGS__);               \
-        RETURN((type_t){.kind = TYPE_ERR}); \
+#define SEM_ERR_RETURN(...)   \
+    do {                      \
+        SEM_ERR(__VA_ARGS__); \
+        RETURN(&type_err);    \
     } while (0)
 
 static inline void SEM_ERR(enum err_id id, u32 line, ...) {
@@ -0,0 +1,224 @@
+#define _DEFAULT_SOURCE
+#include "server.h"
+#include "driver.h"
+#include "flags.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define MAX_ARGS 64
+
+static const char *tmpdir() {
+    const char *dir = getenv("TMPDIR");
+    return dir ? dir : "/tmp";
+}
+
+// a fresh empty file named into `fname`, its fd or -1
+static i32 tmp_open(char *fname, u32 size, const char *what) {
+    snprintf(fname, size, "%s/cmm-%s-XXXXXX", tmpdir(), what);
+    return mkstemp(fname);
+}
+
+static char *read_all(i32 fd, u32 *len) {
+    u32   cap = BUFSIZ;
+    char *buf = malloc(cap);
+    *len      = 0;
+    while (true) {
+        if (*len + 1 == cap) {
+            cap *= 2;
+            buf = realloc(buf, cap);
+        }
+        ssize_t n = read(fd, buf + *len, cap - *len - 1);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        *len += n;
+    }
+    buf[*len] = '\0';
+    return buf;
+}
+
+static void write_all(i32 fd, const char *buf, u32 len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return;
+        }
+        buf += n;
+        len -= n;
+    }
+}
+
+static void send_file(i32 conn, const char *name, const char *fname) {
+    u32   len = 0;
+    char *buf = NULL;
+    i32   fd  = open(fname, O_RDONLY);
+    if (fd >= 0) {
+        buf = read_all(fd, &len);
+        close(fd);
+    }
+    char hdr[MAX_SYM_LEN];
+    snprintf(hdr, sizeof(hdr), "@%s %u\n", name, len);
+    write_all(conn, hdr, strlen(hdr));
+    write_all(conn, buf, len);
+    free(buf);
+}
+
+// points stdout and stderr to `out` and stdin to nothing, the old ones into `saved`
+static void redirect(i32 out, i32 saved[3]) {
+    i32 null = open("/dev/null", O_RDONLY);
+    fflush(stdout);
+    fflush(stderr);
+    for (i32 i = 0; i < 3; i++) {
+        saved[i] = dup(i);
+    }
+    dup2(null, 0);
+    dup2(out, 1);
+    dup2(out, 2);
+    close(null);
+}
+
+static void restore(i32 saved[3]) {
+    fflush(stdout);
+    fflush(stderr);
+    clearerr(stdin);
+    for (i32 i = 0; i < 3; i++) {
+        dup2(saved[i], i);
+        close(saved[i]);
+    }
+}
+
+// an UNREACHABLE or a failed assert() fails the unit, as `fail()` would,
+// rather than the whole server; its message is already in the output
+static void on_abort(i32 sig) {
+    fail();
+}
+
+static i32 compile_unit(const char *sfname, const char *ofname, const char *irname) {
+    jmp_buf          env;
+    i32              status = 1;
+    struct sigaction act    = {.sa_handler = on_abort, .sa_flags = SA_NODEFER}, old;
+    sigemptyset(&act.sa_mask);
+    sigaction(SIGABRT, &act, &old);
+    driver_catch = &env;
+    if (setjmp(env) == 0) {
+        status = compile(sfname, ofname, irname);
+    }
+    driver_catch = NULL;
+    sigaction(SIGABRT, &old, NULL);
+    reset();
+    return status;
+}
+
+static void handle(i32 conn, const flags_t *defaults) {
+    u32   len;
+    char *req  = read_all(conn, &len);
+    char *body = strchr(req, '\n');
+    if (body != NULL) {
+        *body++ = '\0';
+    } else {
+        body = req + len;
+    }
+
+    i32   argc = 1;
+    char *argv[MAX_ARGS + 1] = {"cmm"};
+    for (char *tok = strtok(req, " \t\r"); tok && argc < MAX_ARGS; tok = strtok(NULL, " \t\r")) {
+        argv[argc++] = tok;
+    }
+    argv[argc] = NULL;
+
+    char out_tmp[BUFSIZ], src_tmp[BUFSIZ] = "", s_tmp[BUFSIZ] = "", ir_tmp[BUFSIZ] = "";
+    i32  out    = tmp_open(out_tmp, sizeof(out_tmp), "out");
+    i32  status = 1;
+    if (out < 0) {
+        free(req);
+        return;
+    }
+
+    i32 saved[3];
+    redirect(out, saved);
+    flags    = *defaults;
+    i32 argi = flags_parse(argc, argv);
+    if (argi < 0 || argi == argc || argc - argi > 2) {
+        printf("usage: [-FLAG..] SOURCE [OUTPUT]\n");
+    } else {
+        const char *sfname = argv[argi];
+        const char *ofname = argi + 1 < argc ? argv[argi + 1] : "-";
+        char        irname[BUFSIZ];
+        bool        send   = !strcmp(ofname, "-");
+        if (!strcmp(sfname, "-")) {
+            i32 fd = tmp_open(src_tmp, sizeof(src_tmp), "src");
+            write_all(fd, body, req + len - body);
+            close(fd);
+            sfname = src_tmp;
+        }
+        if (send) {
+            close(tmp_open(s_tmp, sizeof(s_tmp), "s"));
+            close(tmp_open(ir_tmp, sizeof(ir_tmp), "ir"));
+            ofname = s_tmp;
+            snprintf(irname, sizeof(irname), "%s", ir_tmp);
+        } else {
+            with_ext(irname, sizeof(irname), ofname, ".ir");
+        }
+        status = compile_unit(sfname, ofname, irname);
+    }
+    restore(saved);
+    send_file(conn, "out", out_tmp);
+    if (s_tmp[0] != '\0') {
+        send_file(conn, "s", s_tmp);
+        send_file(conn, "ir", ir_tmp);
+    }
+    dprintf(conn, "@status %d\n", status);
+
+    close(out);
+    const char *tmps[] = {out_tmp, src_tmp, s_tmp, ir_tmp};
+    for (u32 i = 0; i < ARR_LEN(tmps); i++) {
+        if (tmps[i][0] != '\0') {
+            unlink(tmps[i]);
+        }
+    }
+    free(req);
+}
+
+i32 serve(const char *path) {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "%s: socket path too long\n", path);
+        return 1;
+    }
+    strcpy(addr.sun_path, path);
+    i32 sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path);
+    if (sock < 0 || bind(sock, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(sock, 16) < 0) {
+        perror(path);
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    flags_t defaults = flags;
+    defaults.serve   = NULL;
+    while (true) {
+        i32 conn = accept(sock, NULL, NULL);
+        if (conn < 0 && errno == EINTR) {
+            continue;
+        }
+        if (conn < 0) {
+            perror(path);
+            break;
+        }
+        handle(conn, &defaults);
+        close(conn);
+    }
+    close(sock);
+    return 1;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "common.h"
+
+/**
+ * `-serve=PATH` keeps one compiler process listening on the Unix
+ * socket PATH, so start-up is paid once and interned types outlive a
+ * request. Nothing else does: `reset()` frees the AST, the IR, the CFGs
+ * and the symtab after every one, and allocation is plain malloc.
+ *
+ * A request is one line of arguments as on the command line, with the
+ * flags of the server as defaults, and the socket then shut down for
+ * writing:
+ *
+ *   [-FLAG..] SOURCE [OUTPUT]
+ *
+ * SOURCE `-` compiles the bytes after the line instead of a file.
+ * OUTPUT, unless omitted or `-`, receives the assembly and OUTPUT.ir
+ * the IR, as with -batch; otherwise both are sent back. The reply is a
+ * sequence of `@NAME LEN\n` headers each followed by LEN bytes: `out`
+ * with what the compile printed, then `s` and `ir` if sent back, and
+ * last `@status CODE\n` with no bytes, 0 on success. A unit that
+ * aborts the compiler fails with status 1 like any other error.
+ */
+i32 serve(const char *path);
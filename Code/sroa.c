@@ -0,0 +1,156 @@
+#include "alias.h"
+#include "cfg.h"
+#include "common.h"
+#include "ir.h"
+#include "map.h"
+
+/**
+ * Scalar replacement. A struct, or an array only ever indexed by
+ * constants, whose address goes nowhere but into its own loads and stores
+ * gets a variable for every word of it instead. Loads and stores become
+ * copies, which the passes after treat like any other, and the `IR_DEC`
+ * with the address arithmetic into it goes.
+ */
+
+#define MAX_WORDS 16
+
+typedef struct {
+    u32    size;
+    bool   ok;
+    u32    lineno;
+    oprd_t words[MAX_WORDS];
+} obj_t;
+
+static alias_t pa;
+// `IR_DEC` object id => obj_t
+static map_t objs;
+
+// the object `oprd` points into, if it is one to replace
+static obj_t *obj_at(oprd_t oprd, loc_t *loc) {
+    if (oprd.kind != OPRD_VAR) {
+        return NULL;
+    }
+    *loc = alias_loc(&pa, oprd);
+    return loc->ext || loc->base == 0 ? NULL : map_find(&objs, (void *) loc->base);
+}
+
+static oprd_t word(obj_t *obj, i64 off) {
+    oprd_t *var = &obj->words[off / 4];
+    if (var->kind != OPRD_VAR) {
+        *var = var_alloc(NULL, obj->lineno);
+    }
+    return *var;
+}
+
+// whether `ir` only moves an address into `obj` along
+static bool moves(IR_t *ir, loc_t loc) {
+    if (ir->kind != IR_ASSIGN && (ir->kind != IR_BINARY || (ir->op != OP_ADD && ir->op != OP_SUB))) {
+        return false;
+    }
+    loc_t tar = alias_loc(&pa, ir->tar);
+    return !tar.ext && tar.base == loc.base;
+}
+
+// rules out the objects `ir` does more with than load, store or move
+// addresses into them along, false if it may touch any memory at all
+static bool check(IR_t *ir) {
+    loc_t  loc;
+    obj_t *obj;
+    if (ir->kind == IR_LOAD || ir->kind == IR_STORE) {
+        loc = alias_loc(&pa, ir->kind == IR_LOAD ? ir->lhs : ir->tar);
+        if (loc.base == 0 && !loc.ext) {
+            return false;
+        }
+    }
+    if (ir->kind == IR_DEC || ir->kind == IR_DREF) {
+        return true;
+    }
+    oprd_t uses[] = {ir->lhs, ir->rhs, ir->kind == IR_STORE ? ir->tar : (oprd_t){0}};
+    for (u32 i = 0; i < ARR_LEN(uses); i++) {
+        if ((obj = obj_at(uses[i], &loc)) == NULL) {
+            continue;
+        }
+        bool through = (ir->kind == IR_LOAD && i == 0) || (ir->kind == IR_STORE && i == 2);
+        if (through) {
+            obj->ok &= loc.exact && loc.off >= 0 && loc.off < obj->size && loc.off % 4 == 0;
+        } else if (!moves(ir, loc)) {
+            obj->ok = false;
+        }
+    }
+    return true;
+}
+
+static void replace(IR_t *ir) {
+    loc_t  loc;
+    obj_t *obj;
+    switch (ir->kind) {
+        case IR_LOAD: {
+            if ((obj = obj_at(ir->lhs, &loc)) != NULL && obj->ok) {
+                ir->kind = IR_ASSIGN;
+                ir->lhs  = word(obj, loc.off);
+            }
+            break;
+        }
+        case IR_STORE: {
+            if ((obj = obj_at(ir->tar, &loc)) != NULL && obj->ok) {
+                ir->kind = IR_ASSIGN;
+                ir->tar  = word(obj, loc.off);
+            }
+            break;
+        }
+        case IR_DEC: {
+            obj      = map_find(&objs, (void *) ir->tar.id);
+            ir->mark = obj != NULL && obj->ok;
+            break;
+        }
+        case IR_DREF: {
+            obj      = map_find(&objs, (void *) ir->lhs.id);
+            ir->mark = obj != NULL && obj->ok;
+            break;
+        }
+        case IR_ASSIGN:
+        case IR_BINARY: {
+            obj      = obj_at(ir->tar, &loc);
+            ir->mark = obj != NULL && obj->ok;
+            break;
+        }
+        default: break;
+    }
+}
+
+void do_sroa(cfg_t *cfg) {
+    alias_init(&pa, cfg);
+    map_init(&objs);
+    LIST_ITER(cfg->blocks, blk) {
+        LIST_ITER(blk->instrs.head, ir) {
+            loc_t obj = {.base = ir->tar.id, .exact = true};
+            if (ir->kind == IR_DEC && ir->lhs.val <= 4 * MAX_WORDS && !alias_escapes(&pa, obj)) {
+                obj_t *it = zalloc(sizeof(obj_t));
+                *it       = (obj_t){.size = ir->lhs.val, .ok = true, .lineno = ir->tar.lineno};
+                map_insert(&objs, (void *) ir->tar.id, it);
+            }
+        }
+    }
+
+    bool ok = objs.size > 0;
+    LIST_ITER(cfg->blocks, blk) {
+        LIST_ITER(blk->instrs.head, ir) {
+            ok = ok && check(ir);
+        }
+    }
+    LIST_ITER(cfg->blocks, blk) {
+        if (!ok) {
+            break;
+        }
+        LIST_ITER(blk->instrs.head, ir) {
+            replace(ir);
+        }
+        ir_remove_mark(&blk->instrs);
+    }
+
+    map_iter(&objs, it) {
+        zfree(it.val);
+    }
+    map_fini(&objs);
+    alias_fini(&pa);
+}
@@ -6,9 +6,20 @@
 #include <string.h>
 #include <stdbool.h>
 
-static symtab_t *top  = NULL;
-static bool      init = false;
-static syment_t  entries[MAX_SYM];
+#define SYM_CHUNK 1024
+
+// symbols never move once made, so they come a chunk at a time
+typedef struct sym_chunk_t sym_chunk_t;
+
+struct sym_chunk_t {
+    syment_t     entries[SYM_CHUNK];
+    sym_chunk_t *next;
+};
+
+static symtab_t    *top    = NULL;
+static bool         init   = false;
+static sym_chunk_t *chunks = NULL;
+static u32          nentry = 0;
 
 syment_t *sym_lookup(const char *str) {
     ASSERT(init, "symtab used before initialized");
@@ -33,19 +44,24 @@ void sym_scope_pop() {
     ASSERT(init, "symtab used before initialized");
     symtab_t *symtab = top;
     top              = top->next;
+    hash_fini(&symtab->hashtab);
     zfree(symtab);
 }
 
 void *salloc(u32 size) {
-    static syment_t *ptr = entries;
-    ASSERT(ptr - entries != MAX_SYM, "entries overflow");
-    return ptr++;
+    if (chunks == NULL || nentry == SYM_CHUNK) {
+        sym_chunk_t *chunk = zalloc(sizeof(sym_chunk_t));
+        chunk->next        = chunks;
+        chunks             = chunk;
+        nentry             = 0;
+    }
+    return &chunks->entries[nentry++];
 }
 
 void *sym_insert(const char *str, sym_kind_t kind) {
     ASSERT(init, "symtab used before initialized");
     ASSERT(strlen(str) < MAX_SYM_LEN, "sym_insert exceeds MAX_SYM_LEN");
-    hashent_t *ent = hash_lookup(&top->hashtab, str);
+    hashent_t *ent = hash_insert(&top->hashtab, str);
     if (ent->ptr != NULL) {
         return NULL;
     }
@@ -53,7 +69,6 @@ void *sym_insert(const char *str, sym_kind_t kind) {
     syment_t *sym = salloc(sizeof(syment_t));
     *sym          = (syment_t){.kind = kind};
     symcpy(sym->str, str);
-    symcpy(ent->str, str);
 
     ent->ptr = sym;
     return sym;
@@ -68,7 +83,13 @@ void symtab_fini() {
     while (top) {
         sym_scope_pop();
     }
-    init = false;
+    while (chunks) {
+        sym_chunk_t *next = chunks->next;
+        zfree(chunks);
+        chunks = next;
+    }
+    nentry = 0;
+    init   = false;
 }
 
 void symcpy(char *dst, const char *src) {
@@ -21,7 +21,7 @@ struct syment_t {
     EXTENDS(shared);
     sym_kind_t    kind;
     char          str[MAX_SYM_LEN];
-    type_t        typ;
+    const type_t *typ;
     syment_t     *next, *params;
     u32           nparam;
     struct AST_t *body;
@@ -0,0 +1,247 @@
+#include "cfg.h"
+#include "common.h"
+#include "ir.h"
+
+/**
+ * Jump threading. What a predecessor assigned or branched on may already
+ * decide the branch a block ends in, as after `cond.c` lowered `&&` or
+ * `||` into a value that is tested right away, or when two branches test
+ * the same comparison. The edge then goes straight to where the branch
+ * would go, through a copy of the few instructions before it.
+ */
+
+#define MAX_FACTS 16
+#define MAX_DUP 4
+#define MAX_DEPTH 4
+#define NROUND 4
+
+// `lhs op rhs` holds
+typedef struct {
+    op_kind_t op;
+    oprd_t    lhs, rhs;
+} fact_t;
+
+typedef struct {
+    fact_t facts[MAX_FACTS];
+    u32    n;
+} facts_t;
+
+// the orderings of `lhs` against `rhs` a comparison allows
+enum {
+    ORD_LT = 1,
+    ORD_EQ = 2,
+    ORD_GT = 4,
+};
+
+static u32 ord_of(op_kind_t op) {
+    switch (op) {
+        case OP_LT: return ORD_LT;
+        case OP_LE: return ORD_LT | ORD_EQ;
+        case OP_GT: return ORD_GT;
+        case OP_GE: return ORD_GT | ORD_EQ;
+        case OP_EQ: return ORD_EQ;
+        case OP_NE: return ORD_LT | ORD_GT;
+        default: UNREACHABLE;
+    }
+}
+
+// the same orderings, with the operands the other way round
+static u32 ord_swap(u32 ord) {
+    return (ord & ORD_EQ) | (ord & ORD_LT ? ORD_GT : 0) | (ord & ORD_GT ? ORD_LT : 0);
+}
+
+static bool same(oprd_t lhs, oprd_t rhs) {
+    if (lhs.kind != rhs.kind) {
+        return false;
+    }
+    return lhs.kind == OPRD_LIT ? lhs.val == rhs.val : lhs.id == rhs.id;
+}
+
+static void fact_add(facts_t *fs, op_kind_t op, oprd_t lhs, oprd_t rhs) {
+    if (fs->n < MAX_FACTS) {
+        fs->facts[fs->n++] = (fact_t){op, lhs, rhs};
+    }
+}
+
+// the facts after `ir` runs
+static void facts_transfer(facts_t *fs, IR_t *ir) {
+    u32 n = 0;
+    for (u32 i = 0; i < fs->n; i++) {
+        fact_t *f = &fs->facts[i];
+        if (!ir_defines(ir, f->lhs) && !ir_defines(ir, f->rhs)) {
+            fs->facts[n++] = *f;
+        }
+    }
+    fs->n = n;
+    if (ir->kind == IR_ASSIGN && ir->lhs.kind == OPRD_LIT) {
+        fact_add(fs, OP_EQ, ir->tar, ir->lhs);
+    }
+}
+
+// what holds leaving `e->from` along `e`, with what held entering it when
+// it has a single predecessor, `depth` blocks up at most
+static void facts_along(edge_t *e, facts_t *fs, u32 depth) {
+    block_t *from = e->from;
+    fs->n         = 0;
+    if (depth > 0 && from->bedge != NULL && from->bedge->next == NULL) {
+        facts_along(from->bedge->rev, fs, depth - 1);
+    }
+    LIST_ITER(from->instrs.head, ir) {
+        facts_transfer(fs, ir);
+    }
+    IR_t *br = from->instrs.tail;
+    if (br != NULL && br->kind == IR_BRANCH) {
+        switch (e->kind) {
+            case EDGE_TRUE: fact_add(fs, br->op, br->lhs, br->rhs); break;
+            case EDGE_THROUGH: fact_add(fs, op_negate(br->op), br->lhs, br->rhs); break;
+            default: break;
+        }
+    }
+}
+
+// 1 if `br` is taken wherever `fs` holds, 0 if it is not, -1 if `fs` does
+// not tell
+static i32 decide(const facts_t *fs, const IR_t *br) {
+    oprd_t lhs = br->lhs, rhs = br->rhs;
+    for (u32 i = 0; i < fs->n; i++) {
+        const fact_t *f = &fs->facts[i];
+        if (f->op == OP_EQ && f->rhs.kind == OPRD_LIT) {
+            lhs = same(lhs, f->lhs) ? f->rhs : lhs;
+            rhs = same(rhs, f->lhs) ? f->rhs : rhs;
+        }
+    }
+    u32 ord = ord_of(br->op);
+    if (lhs.kind == OPRD_LIT && rhs.kind == OPRD_LIT) {
+        u32 at = lhs.val < rhs.val ? ORD_LT : lhs.val == rhs.val ? ORD_EQ
+                                                                 : ORD_GT;
+        return (ord & at) != 0;
+    }
+    for (u32 i = 0; i < fs->n; i++) {
+        const fact_t *f     = &fs->facts[i];
+        u32           known = ord_of(f->op);
+        if (same(f->lhs, rhs) && same(f->rhs, lhs)) {
+            known = ord_swap(known);
+        } else if (!same(f->lhs, lhs) || !same(f->rhs, rhs)) {
+            continue;
+        }
+        if ((known & ~ord) == 0) {
+            return 1;
+        }
+        if ((known & ord) == 0) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// `blk`, or the block it only jumps on to
+static block_t *skip_gotos(block_t *blk) {
+    for (u32 i = 0; i < MAX_DEPTH && blk->instrs.tail && blk->instrs.tail->kind == IR_GOTO; i++) {
+        LIST_ITER(blk->instrs.head, ir) {
+            if (ir != blk->instrs.tail && ir->kind != IR_LABEL) {
+                return blk;
+            }
+        }
+        blk = blk->instrs.tail->jmpto->parent;
+    }
+    return blk;
+}
+
+// whether `ir`, of the block ending in `br`, goes into a copy of it; where
+// an object is declared or a parameter arrives stays the one place
+static bool duplicable(const IR_t *ir, const IR_t *br) {
+    return ir != br && ir->kind != IR_LABEL && ir->kind != IR_DEC && ir->kind != IR_PARAM;
+}
+
+static block_t *succ_of(block_t *blk, edge_kind_t kind) {
+    succ_iter(blk, e) {
+        if (e->kind == kind) {
+            return e->to;
+        }
+    }
+    return NULL;
+}
+
+// sends `e` on to where the branch of `e->to` goes, false if it cannot
+static bool thread(cfg_t *cfg, edge_t *e) {
+    block_t *from = e->from, *blk = e->to;
+    IR_t    *br = blk->instrs.tail, *last = from->instrs.tail;
+    if (br == NULL || br->kind != IR_BRANCH || from == blk || e->kind == EDGE_RETURN) {
+        return false;
+    }
+    // both ways out of `from` lead to `blk`
+    if (last != NULL && last->kind == IR_BRANCH && last->jmpto->parent == succ_of(from, EDGE_THROUGH)) {
+        return false;
+    }
+
+    facts_t fs;
+    u32     ndup = 0;
+    facts_along(e, &fs, MAX_DEPTH);
+    LIST_ITER(blk->instrs.head, ir) {
+        if (ir->kind == IR_DEC || ir->kind == IR_PARAM) {
+            return false;
+        }
+        if (duplicable(ir, br)) {
+            facts_transfer(&fs, ir);
+            ndup++;
+        }
+    }
+    i32 taken = decide(&fs, br);
+    if (ndup > MAX_DUP || taken < 0) {
+        return false;
+    }
+    block_t *dest = taken ? br->jmpto->parent : succ_of(blk, EDGE_THROUGH);
+    dest = dest ? skip_gotos(dest) : NULL;
+    if (dest == NULL || dest == blk || dest == cfg->exit) {
+        return false;
+    }
+
+    e->mark = e->rev->mark = true;
+    if (ndup == 0 && e->kind != EDGE_THROUGH) {
+        last->jmpto = block_label(dest);
+        edge_insert(cfg, from, dest, e->kind);
+        return true;
+    }
+    // a block falling out of a branch needs no label
+    ir_list instrs = {0};
+    if (e->kind != EDGE_THROUGH) {
+        ir_append(&instrs, ir_alloc(IR_LABEL));
+    }
+    LIST_ITER(blk->instrs.head, ir) {
+        if (duplicable(ir, br)) {
+            ir_append(&instrs, ir_copy(ir));
+        }
+    }
+    ir_append(&instrs, ir_alloc(IR_GOTO, block_label(dest)));
+    block_t *copy = block_alloc(cfg, instrs);
+    if (e->kind != EDGE_THROUGH) {
+        last->jmpto = copy->instrs.head;
+    }
+    edge_insert(cfg, from, copy, e->kind);
+    edge_insert(cfg, copy, dest, EDGE_GOTO);
+    return true;
+}
+
+static bool thread_any(cfg_t *cfg, block_t *blk) {
+    pred_iter(blk, e) {
+        if (thread(cfg, e->rev)) {
+            edge_remove_mark(cfg);
+            return true;
+        }
+    }
+    return false;
+}
+
+void do_thread(cfg_t *cfg) {
+    for (u32 round = 0; round < NROUND; round++) {
+        bool changed = false;
+        LIST_ITER(cfg->blocks, blk) {
+            while (thread_any(cfg, blk)) {
+                changed = true;
+            }
+        }
+        if (!changed) {
+            break;
+        }
+    }
+}
@@ -3,28 +3,29 @@
 #include "type.h"
 #include <string.h>
 
-type_t type_int = (type_t){
-    .kind     = TYPE_PRIM_INT,
-    .elem_typ = NULL,
-    .fields   = NULL,
-    .is_ref   = false,
-    .size     = 4};
-
-type_t type_flt = (type_t){
-    .kind     = TYPE_PRIM_FLT,
-    .elem_typ = NULL,
-    .fields   = NULL,
-    .is_ref   = false,
-    .size     = 4};
-
-type_t type_err = (type_t){
-    .kind     = TYPE_ERR,
-    .elem_typ = NULL,
-    .fields   = NULL,
-    .is_ref   = false,
-    .size     = 0};
-
-field_t *field_alloc(type_t typ, const char str[]) {
+#define NBUCKET 4096
+
+const type_t type_null = {
+    .kind  = TYPE_NULL,
+    .shape = &type_null};
+
+const type_t type_err = {
+    .kind  = TYPE_ERR,
+    .shape = &type_err};
+
+const type_t type_int = {
+    .kind  = TYPE_PRIM_INT,
+    .size  = 4,
+    .shape = &type_int};
+
+const type_t type_flt = {
+    .kind  = TYPE_PRIM_FLT,
+    .size  = 4,
+    .shape = &type_flt};
+
+static type_t *buckets[NBUCKET];
+
+field_t *field_alloc(const type_t *typ, const char str[]) {
     field_t *ptr = zalloc(sizeof(field_t));
     symcpy(ptr->str, str);
     ptr->typ = typ;
@@ -32,86 +33,143 @@ field_t *field_alloc(type_t typ, const char str[]) {
 }
 
 void field_free(field_t *field) {
-    if (field->next != NULL) {
-        field_free(field->next);
+    if (field == NULL) {
+        return;
     }
-    typ_free(field->typ);
+    field_free(field->next);
     zfree(field);
 }
 
-void typ_free(type_t typ) {
-    if (typ.is_ref) {
-        return;
+static u32 mix(u32 hash, uptr val) {
+    return (hash ^ (u32) val ^ (u32) (val >> 32)) * 16777619u;
+}
+
+static u32 type_hash(const type_t *typ) {
+    u32 hash = mix(2166136261u, typ->kind);
+    for (const char *s = typ->str; *s; s++) {
+        hash = mix(hash, *s);
     }
-    if (typ.fields != NULL) {
-        field_free(typ.fields);
+    LIST_ITER(typ->fields, it) {
+        for (const char *s = it->str; *s; s++) {
+            hash = mix(hash, *s);
+        }
+        hash = mix(hash, (uptr) it->typ);
     }
-    if (typ.elem_typ != NULL) {
-        typ_free(*typ.elem_typ);
-        zfree(typ.elem_typ);
-        typ.elem_typ = NULL;
+    hash = mix(hash, (uptr) typ->elem_typ);
+    for (u32 i = 0; i < typ->dim; i++) {
+        hash = mix(hash, typ->len[i]);
     }
+    return mix(hash, typ->dim);
 }
 
-static bool field_eq(field_t *f1, field_t *f2) {
-    if (f1 == f2) {
-        return true;
-    }
-    if (f1 == NULL || f2 == NULL) {
+// field types are interned already, so comparing one level is enough
+static bool same(const type_t *typ1, const type_t *typ2) {
+    if (typ1->hash != typ2->hash || typ1->kind != typ2->kind
+        || typ1->elem_typ != typ2->elem_typ || typ1->dim != typ2->dim
+        || symcmp(typ1->str, typ2->str)) {
         return false;
     }
-    if (!type_eq(f1->typ, f2->typ)) {
+    if (typ1->dim && memcmp(typ1->len, typ2->len, typ1->dim * sizeof(u32))) {
         return false;
     }
-    return field_eq(f1->next, f2->next);
+    field_t *f1 = typ1->fields, *f2 = typ2->fields;
+    for (; f1 != NULL && f2 != NULL; f1 = f1->next, f2 = f2->next) {
+        if (f1->typ != f2->typ || symcmp(f1->str, f2->str)) {
+            return false;
+        }
+    }
+    return f1 == f2;
 }
 
-bool type_eq(type_t typ1, type_t typ2) {
-    if (typ1.kind == TYPE_ERR || typ2.kind == TYPE_ERR) {
-        return true;
-    }
-    if (typ1.kind != typ2.kind) {
+static bool is_shape(const type_t *typ) {
+    if (typ->str[0] != '\0' || typ->dim != 0) {
         return false;
     }
-    switch (typ1.kind) {
-        case TYPE_PRIM_FLT:
-        case TYPE_PRIM_INT:
-            return true;
-        case TYPE_STRUCT:
-            return field_eq(typ1.fields, typ2.fields);
-        case TYPE_ARRAY:
-            return type_eq(*typ1.elem_typ, *typ2.elem_typ);
-        default:
-            UNREACHABLE;
-    }
-    UNREACHABLE;
+    LIST_ITER(typ->fields, it) {
+        if (it->str[0] != '\0' || it->typ->shape != it->typ) {
+            return false;
+        }
+    }
+    return typ->elem_typ == NULL || typ->elem_typ->shape == typ->elem_typ;
 }
 
-u32 typ_set_size(type_t *typ) {
-    u32 size = 0;
+/**
+ * Structs are equal if their fields are of equal types, and arrays if
+ * their elements are, so a shape drops names and dimensions.
+ */
+static const type_t *shape_of(const type_t *typ) {
     switch (typ->kind) {
-        case TYPE_PRIM_FLT: size = 4; break;
-        case TYPE_PRIM_INT: size = 4; break;
         case TYPE_STRUCT: {
+            field_t *fields = NULL;
             LIST_ITER(typ->fields, it) {
-                it->off = size;
-                size += typ_set_size(&it->typ);
+                LIST_APPEND(fields, field_alloc(it->typ->shape, ""));
             }
-            break;
+            return type_struct("", fields);
         }
-        case TYPE_ARRAY: {
-            size = typ->elem_typ->size;
-            for (u32 i = typ->dim; i > 0; i--) {
-                typ->acc[i - 1] = size;
-                size *= typ->len[i - 1];
-            }
-            break;
-        }
-        default: {
-            UNREACHABLE;
+        case TYPE_ARRAY: return type_array(typ->elem_typ->shape, 0, NULL);
+        default: UNREACHABLE;
+    }
+}
+
+/**
+ * Returns the interned copy of `*typ`, which takes over its fields and
+ * dimensions, or frees them if it already exists.
+ */
+static const type_t *intern(type_t *typ) {
+    typ->hash       = type_hash(typ);
+    type_t **bucket = &buckets[typ->hash % NBUCKET];
+    LIST_ITER(*bucket, it) {
+        if (same(it, typ)) {
+            field_free(typ->fields);
+            zfree(typ->len);
+            zfree(typ->acc);
+            return it;
         }
     }
-    return typ->size = size;
+    type_t *ptr = zalloc(sizeof(type_t));
+    *ptr        = *typ;
+    ptr->next   = *bucket;
+    *bucket     = ptr;
+    ptr->shape  = is_shape(ptr) ? ptr : shape_of(ptr);
+    return ptr;
+}
+
+const type_t *type_struct(const char *str, field_t *fields) {
+    type_t typ = {.kind = TYPE_STRUCT, .fields = fields};
+    symcpy(typ.str, str);
+    LIST_ITER(fields, it) {
+        it->off = typ.size;
+        typ.size += it->typ->size;
+    }
+    return intern(&typ);
+}
+
+const type_t *type_array(const type_t *elem_typ, u32 dim, const u32 *len) {
+    type_t typ = {
+        .kind     = TYPE_ARRAY,
+        .elem_typ = elem_typ,
+        .dim      = dim,
+        .size     = elem_typ->size};
+    if (dim != 0) {
+        typ.len = zalloc(dim * sizeof(u32));
+        typ.acc = zalloc(dim * sizeof(u32));
+        memcpy(typ.len, len, dim * sizeof(u32));
+    }
+    for (u32 i = dim; i > 0; i--) {
+        typ.acc[i - 1] = typ.size;
+        typ.size *= typ.len[i - 1];
+    }
+    return intern(&typ);
+}
+
+bool type_eq(const type_t *typ1, const type_t *typ2) {
+    if (typ1->kind == TYPE_ERR || typ2->kind == TYPE_ERR) {
+        return true;
+    }
+    if (typ1->kind == TYPE_ARRAY && typ2->kind == TYPE_ARRAY) {
+        return type_eq(typ1->elem_typ, typ2->elem_typ);
+    }
+    return typ1->shape == typ2->shape;
 }
 
 bool field_exist(field_t *field, const char *str) {
@@ -121,4 +179,4 @@ bool field_exist(field_t *field, const char *str) {
         }
     }
     return false;
-}
\ No newline at end of file
+}
@@ -8,6 +8,10 @@ typedef struct type_t type_t;
 
 typedef struct field_t field_t;
 
+/**
+ * Types are interned: each distinct type exists once and is immutable,
+ * so they are passed around as `const type_t *`.
+ */
 struct type_t {
     enum type_kind {
         TYPE_NULL = 0,
@@ -17,39 +21,47 @@ struct type_t {
         TYPE_STRUCT,
         TYPE_ARRAY
     } kind;
-    char     str[MAX_SYM_LEN];
-    field_t *fields;
-    type_t  *elem_typ;
-    u32      len[MAX_DIM], dim;
-    u32      acc[MAX_DIM], size;
-    bool     is_ref; // e.g. struct STRUCT_NAME field;
+    char          str[MAX_SYM_LEN];
+    field_t      *fields;
+    const type_t *elem_typ;
+    u32          *len, *acc, dim;
+    u32           size;
+
+    // the interned type that stands for every type `type_eq` to this one
+    const type_t *shape;
+    type_t       *next;
+    u32           hash;
 };
 
 struct field_t {
-    field_t *next;
-    char     str[MAX_SYM_LEN];
-    type_t   typ;
-    u32      off;
+    field_t      *next;
+    char          str[MAX_SYM_LEN];
+    const type_t *typ;
+    u32           off;
 };
 
-#define IS_SCALAR(TYPE)                \
-    (((TYPE).kind == TYPE_PRIM_INT)    \
-     || ((TYPE).kind == TYPE_PRIM_FLT) \
-     || ((TYPE).kind == TYPE_ERR))
+#define IS_SCALAR(TYPE)                 \
+    (((TYPE)->kind == TYPE_PRIM_INT)    \
+     || ((TYPE)->kind == TYPE_PRIM_FLT) \
+     || ((TYPE)->kind == TYPE_ERR))
+
+#define IS_LOGIC(TYPE)                \
+    ((((TYPE)->kind == TYPE_PRIM_INT) \
+      && IS_SCALAR(TYPE))             \
+     || ((TYPE)->kind == TYPE_ERR))
 
-#define IS_LOGIC(TYPE)               \
-    ((((TYPE).kind == TYPE_PRIM_INT) \
-      && IS_SCALAR(TYPE))            \
-     || ((TYPE).kind == TYPE_ERR))
+extern const type_t type_null, type_err, type_int, type_flt;
 
-field_t *field_alloc(type_t typ, const char str[]);
+field_t *field_alloc(const type_t *typ, const char str[]);
 
 void field_free(field_t *field);
 
-void typ_free(type_t typ);
+// takes over `fields`
+const type_t *type_struct(const char *str, field_t *fields);
 
-bool type_eq(type_t typ1, type_t typ2);
+// `len` is copied
+const type_t *type_array(const type_t *elem_typ, u32 dim, const u32 *len);
 
-u32 typ_set_size(type_t *typ);
+bool type_eq(const type_t *typ1, const type_t *typ2);
 
-bool field_exist(field_t *field, const char *str);
\ No newline at end of file
+bool field_exist(field_t *field, const char *str);
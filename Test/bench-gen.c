@@ -0,0 +1,201 @@
+#include "common.h"
+#include <stdbool.h>
+#include <string.h>
+
+/**
+ * Synthetic C-- generator for compile-time benchmarks.
+ *
+ *   bench-gen [-f NFUN] [-b NBLOCK] [-d DEPTH] [-e NTERM] [-s] [-a] [-r SEED]
+ *
+ * Every function gets NBLOCK top level blocks, each an if/while nest of
+ * DEPTH levels whose leaves are assignments of NTERM-term expressions;
+ * every while runs three times on a counter declared in its own scope.
+ * `-s` adds a local struct, `-a` a local array. Loops are bounded and
+ * values are kept small, so the output also runs under a simulator.
+ */
+
+#define NVAR 4
+#define NARR 8
+
+static u32  nfun = 8, nblock = 8, depth = 2, nterm = 4, seed = 1;
+static bool use_struct, use_array;
+static u32  nloop;
+
+static u32 rnd(u32 bound) {
+    seed = seed * 1103515245u + 12345u;
+    return (seed >> 16) % bound;
+}
+
+static void indent(u32 dep) {
+    for (u32 i = 0; i < dep; i++) {
+        printf("    ");
+    }
+}
+
+// an int valued lvalue or rvalue
+static void term(bool lval) {
+    u32 pick = rnd(4);
+    if (pick == 1 && use_array) {
+        printf("a[%u]", rnd(NARR));
+    } else if (pick == 2 && use_struct) {
+        if (rnd(2)) {
+            printf("s.x");
+        } else {
+            printf("s.v[%u]", rnd(4));
+        }
+    } else if (pick == 3 && !lval) {
+        printf("%u", rnd(10));
+    } else {
+        printf("v%u", rnd(NVAR));
+    }
+}
+
+// |expr| <= 3 * NTERM * max, so dividing by 3 * NTERM + 1 keeps values bounded
+static void assign(u32 dep) {
+    indent(dep);
+    term(true);
+    printf(" = (");
+    for (u32 i = 0; i < nterm; i++) {
+        if (i != 0) {
+            printf(rnd(2) ? " + " : " - ");
+        }
+        term(false);
+        if (rnd(3) == 0) {
+            printf(" * %u", rnd(3) + 1);
+        }
+    }
+    printf(") / %u;\n", 3 * nterm + 1);
+}
+
+static void cond() {
+    static const char *rel[] = {"<", "<=", ">", ">=", "==", "!="};
+    term(false);
+    printf(" %s ", rel[rnd(ARR_LEN(rel))]);
+    term(false);
+    if (rnd(3) == 0) {
+        printf(rnd(2) ? " && " : " || ");
+        term(false);
+        printf(" %s ", rel[rnd(ARR_LEN(rel))]);
+        term(false);
+    }
+}
+
+static void block(u32 dep, u32 left) {
+    if (left == 0) {
+        assign(dep);
+        assign(dep);
+        return;
+    }
+    if (rnd(2)) {
+        indent(dep);
+        printf("if (");
+        cond();
+        printf(") {\n");
+        block(dep + 1, left - 1);
+        indent(dep);
+        printf("} else {\n");
+        block(dep + 1, left - 1);
+        indent(dep);
+        printf("}\n");
+    } else {
+        u32 k = nloop++;
+        indent(dep);
+        printf("{\n");
+        indent(dep + 1);
+        printf("int k%u = 0;\n", k);
+        indent(dep + 1);
+        printf("while (k%u < 3) {\n", k);
+        block(dep + 2, left - 1);
+        indent(dep + 2);
+        printf("k%u = k%u + 1;\n", k, k);
+        indent(dep + 1);
+        printf("}\n");
+        indent(dep);
+        printf("}\n");
+    }
+}
+
+static void function(u32 id) {
+    if (id + 1 == nfun) {
+        printf("int main() {\n");
+    } else {
+        printf("int f%u(int p0, int p1) {\n", id);
+    }
+    for (u32 i = 0; i < NVAR; i++) {
+        printf("    int v%u = %u;\n", i, (id + i) % 7);
+    }
+    if (use_array) {
+        printf("    int a[%u];\n", NARR);
+    }
+    if (use_struct) {
+        printf("    struct S s;\n");
+    }
+    if (use_array) {
+        for (u32 i = 0; i < NARR; i++) {
+            printf("    a[%u] = %u;\n", i, i);
+        }
+    }
+    if (use_struct) {
+        printf("    s.x = 1;\n");
+        for (u32 i = 0; i < 4; i++) {
+            printf("    s.v[%u] = %u;\n", i, i);
+        }
+    }
+    if (id != 0) {
+        printf("    v0 = f%u(v1, v2);\n", id - 1);
+    } else if (id + 1 != nfun) {
+        printf("    v0 = p0 + p1;\n");
+    }
+    for (u32 i = 0; i < nblock; i++) {
+        block(1, depth);
+    }
+    if (id + 1 == nfun) {
+        printf("    write(v0 + v1 + v2 + v3);\n");
+        printf("    return 0;\n");
+    } else {
+        printf("    return v0 + v3;\n");
+    }
+    printf("}\n\n");
+}
+
+static u32 arg_u32(i32 argc, char **argv, i32 *i) {
+    if (*i + 1 >= argc) {
+        fprintf(stderr, "%s expects a number\n", argv[*i]);
+        exit(1);
+    }
+    return (u32) atoi(argv[++*i]);
+}
+
+int main(int argc, char **argv) {
+    for (i32 i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-f")) {
+            nfun = arg_u32(argc, argv, &i);
+        } else if (!strcmp(argv[i], "-b")) {
+            nblock = arg_u32(argc, argv, &i);
+        } else if (!strcmp(argv[i], "-d")) {
+            depth = arg_u32(argc, argv, &i);
+        } else if (!strcmp(argv[i], "-e")) {
+            nterm = arg_u32(argc, argv, &i);
+        } else if (!strcmp(argv[i], "-r")) {
+            seed = arg_u32(argc, argv, &i);
+        } else if (!strcmp(argv[i], "-s")) {
+            use_struct = true;
+        } else if (!strcmp(argv[i], "-a")) {
+            use_array = true;
+        } else {
+            fprintf(stderr, "usage: %s [-f NFUN] [-b NBLOCK] [-d DEPTH] [-e NTERM] [-s] [-a] [-r SEED]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (nfun == 0 || nterm == 0) {
+        fprintf(stderr, "need at least one function and one term\n");
+        return 1;
+    }
+    if (use_struct) {
+        printf("struct S {\n    int x;\n    int v[4];\n};\n\n");
+    }
+    for (u32 i = 0; i < nfun; i++) {
+        function(i);
+    }
+    return 0;
+}
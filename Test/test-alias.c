@@ -0,0 +1,86 @@
+#include "alias.h"
+#include "cfg.h"
+#include "common.h"
+#include "ir.h"
+#include "symtab.h"
+
+static oprd_t a, b, p, q, pa, pb, pi, px, qx, qy, i, t, c;
+
+// what `lexpr.c` gives for two arrays, a struct parameter and a call
+static cfg_t *build() {
+    ir_list list = {0};
+    oprd_t  da = var_alloc(NULL, 1), db = var_alloc(NULL, 1), s = var_alloc(NULL, 1), w = var_alloc(NULL, 1);
+    a = var_alloc("a", 1), b = var_alloc("b", 1), p = var_alloc("p", 1), q = var_alloc("q", 1);
+    pa = var_alloc(NULL, 2), pb = var_alloc(NULL, 2), pi = var_alloc(NULL, 2), px = var_alloc(NULL, 2);
+    qx = var_alloc(NULL, 2), qy = var_alloc(NULL, 2), i = var_alloc("i", 2), t = var_alloc(NULL, 2);
+    c = var_alloc(NULL, 2);
+    ir_append(&list, ir_alloc(IR_PARAM, p));
+    ir_append(&list, ir_alloc(IR_PARAM, q));
+    ir_append(&list, ir_alloc(IR_PARAM, i));
+    ir_append(&list, ir_alloc(IR_DEC, da, lit_alloc(16)));
+    ir_append(&list, ir_alloc(IR_DREF, a, da));
+    ir_append(&list, ir_alloc(IR_DEC, db, lit_alloc(16)));
+    ir_append(&list, ir_alloc(IR_DREF, b, db));
+    // a[1], b[1], a[i]
+    ir_append(&list, ir_alloc(IR_BINARY, OP_ADD, pa, a, lit_alloc(4)));
+    ir_append(&list, ir_alloc(IR_BINARY, OP_ADD, pb, b, lit_alloc(4)));
+    ir_append(&list, ir_alloc(IR_BINARY, OP_MUL, t, i, lit_alloc(4)));
+    ir_append(&list, ir_alloc(IR_BINARY, OP_ADD, pi, a, t));
+    // a[1] again, through a copy
+    ir_append(&list, ir_alloc(IR_ASSIGN, s, a));
+    ir_append(&list, ir_alloc(IR_BINARY, OP_ADD, px, s, lit_alloc(4)));
+    // p.y, q.y
+    ir_append(&list, ir_alloc(IR_BINARY, OP_ADD, qx, p, lit_alloc(4)));
+    ir_append(&list, ir_alloc(IR_BINARY, OP_ADD, qy, q, lit_alloc(4)));
+    ir_append(&list, ir_alloc(IR_STORE, pa, i));
+    ir_append(&list, ir_alloc(IR_LOAD, w, pb));
+    ir_append(&list, ir_alloc(IR_ARG, b));
+    ir_append(&list, ir_alloc(IR_CALL, c, "g"));
+    ir_append(&list, ir_alloc(IR_RETURN, w));
+
+    ir_fun_t *fun = zalloc(sizeof(ir_fun_t));
+    symcpy(fun->str, "f");
+    fun->instrs = list;
+    return cfg_build(fun);
+}
+
+static alias_kind_t between(alias_t *pa_, oprd_t lhs, oprd_t rhs) {
+    return alias_query(alias_loc(pa_, lhs), alias_loc(pa_, rhs));
+}
+
+static void test_query() {
+    cfg_t  *cfg = build();
+    alias_t al;
+    alias_init(&al, cfg);
+
+    assert(between(&al, pa, px) == ALIAS_MUST); // a[1] twice
+    assert(between(&al, pa, a) == ALIAS_NO); // a[1] and a[0]
+    assert(between(&al, pa, pb) == ALIAS_NO); // two arrays
+    assert(between(&al, pa, pi) == ALIAS_MAY); // a[1] and a[i]
+    assert(between(&al, pb, pi) == ALIAS_NO); // b[1] and a[i]
+    assert(between(&al, qx, pa) == ALIAS_NO); // a parameter and a local
+    assert(between(&al, qx, p) == ALIAS_NO); // p.y and p.x
+    assert(between(&al, qx, qy) == ALIAS_MAY); // two parameters
+    assert(between(&al, t, pa) == ALIAS_MAY); // not an address
+
+    assert(alias_escapes(&al, alias_loc(&al, pb))); // b passed to g
+    assert(!alias_escapes(&al, alias_loc(&al, pi))); // a kept
+    assert(alias_escapes(&al, alias_loc(&al, qx))); // the caller's
+
+    IR_t *st = NULL, *ld = NULL;
+    LIST_ITER(cfg->blocks, blk) {
+        LIST_ITER(blk->instrs.head, ir) {
+            st = ir->kind == IR_STORE ? ir : st;
+            ld = ir->kind == IR_LOAD ? ir : ld;
+        }
+    }
+    assert(alias_mem(&al, st, ld) == ALIAS_NO); // store to a, load from b
+    assert(alias_mem(&al, st, st) == ALIAS_MUST); // the store itself
+    alias_fini(&al);
+}
+
+int main() {
+    test_query();
+    printf("PASSED\n");
+    return 0;
+}
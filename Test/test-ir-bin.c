@@ -0,0 +1,150 @@
+#define _DEFAULT_SOURCE
+#include "common.h"
+#include "ir-bin.h"
+#include "ir.h"
+#include "symtab.h"
+#include <string.h>
+#include <unistd.h>
+
+// the text `ir_fun_print` gives for `fun`
+static char *print(ir_fun_t *fun) {
+    char  *buf;
+    size_t size;
+    FILE  *file = open_memstream(&buf, &size);
+    ir_fun_print(file, fun);
+    fclose(file);
+    return buf;
+}
+
+static ir_fun_t *fun_alloc(const char *str, ir_list instrs) {
+    ir_fun_t *fun = zalloc(sizeof(ir_fun_t));
+    symcpy(fun->str, str);
+    fun->instrs = instrs;
+    return fun;
+}
+
+static ir_fun_t *build_sum() {
+    ir_list list = {0};
+    oprd_t  n = var_alloc("n", 1), s = var_alloc("s", 2), t = var_alloc(NULL, 3);
+    IR_t   *loop = ir_alloc(IR_LABEL), *done = ir_alloc(IR_LABEL);
+    ir_append(&list, ir_alloc(IR_PARAM, n));
+    ir_append(&list, ir_alloc(IR_ASSIGN, s, lit_alloc(-7)));
+    ir_append(&list, loop);
+    ir_append(&list, ir_alloc(IR_BRANCH, OP_LE, n, lit_alloc(0), done));
+    ir_append(&list, ir_alloc(IR_BINARY, OP_ADD, s, s, n));
+    ir_append(&list, ir_alloc(IR_BINARY, OP_SUB, n, n, lit_alloc(1)));
+    ir_append(&list, ir_alloc(IR_GOTO, loop));
+    ir_append(&list, done);
+    ir_append(&list, ir_alloc(IR_DEC, t, lit_alloc(8)));
+    ir_append(&list, ir_alloc(IR_STORE, t, s));
+    ir_append(&list, ir_alloc(IR_LOAD, s, t));
+    ir_append(&list, ir_alloc(IR_WRITE, s, s));
+    ir_append(&list, ir_alloc(IR_RETURN, lit_alloc(INT64_MIN)));
+    return fun_alloc("sum", list);
+}
+
+static ir_fun_t *build_main() {
+    ir_list list = {0};
+    oprd_t  x = var_alloc("x", 1), y = var_alloc(NULL, 1);
+    ir_append(&list, ir_alloc(IR_READ, x));
+    ir_append(&list, ir_alloc(IR_ARG, x));
+    ir_append(&list, ir_alloc(IR_CALL, y, "sum"));
+    ir_append(&list, ir_alloc(IR_RETURN, y));
+    return fun_alloc("main", list);
+}
+
+static void test_roundtrip() {
+    char      fname[] = "/tmp/test-ir-bin-XXXXXX";
+    ir_fun_t *prog    = build_sum();
+    prog->next        = build_main();
+    // as `lower` leaves them, with variable ids of their own
+    LIST_ITER(prog, fun) {
+        ir_renumber(fun);
+    }
+    FILE *file        = fdopen(mkstemp(fname), "w");
+    ir_bin_write(file, prog);
+    fclose(file);
+
+    ir_bin_t *bin = ir_bin_open(fname);
+    assert(bin != NULL);
+    assert(ir_bin_count(bin) == 2);
+    assert(!strcmp(ir_bin_name(bin, 0), "sum"));
+    assert(!strcmp(ir_bin_name(bin, 1), "main"));
+    assert(ir_bin_find(bin, "nope") == NULL);
+
+    ir_fun_t *sum = ir_bin_fun(bin, 0), *main = ir_bin_find(bin, "main");
+    assert(sum != NULL && main != NULL);
+    sum->next = main;
+    char *want = print(prog), *got = print(sum);
+    assert(!strcmp(want, got));
+
+    // the same instruction ids, and jumps to the same places
+    for (IR_t *lhs = prog->instrs.head, *rhs = sum->instrs.head; lhs; lhs = lhs->next, rhs = rhs->next) {
+        assert(lhs->id == rhs->id);
+        assert((lhs->jmpto == NULL) == (rhs->jmpto == NULL));
+        assert(!lhs->jmpto || lhs->jmpto->id == rhs->jmpto->id);
+    }
+    free(want);
+    free(got);
+    LIST_ITER(prog, fun) {
+        ir_list_free(&fun->instrs);
+    }
+    LIST_ITER(sum, fun) {
+        ir_list_free(&fun->instrs);
+    }
+    ir_fun_free(prog);
+    ir_fun_free(sum);
+    ir_bin_close(bin);
+    unlink(fname);
+}
+
+static void test_malformed() {
+    char fname[] = "/tmp/test-ir-bin-XXXXXX";
+    FILE *file   = fdopen(mkstemp(fname), "w");
+    fputs("CMMIRC", file);
+    fclose(file);
+    assert(ir_bin_open(fname) == NULL);
+
+    // a section cut short
+    ir_fun_t *prog = build_main();
+    file           = fopen(fname, "w");
+    ir_bin_write(file, prog);
+    fflush(file);
+    assert(!ftruncate(fileno(file), ftell(file) - 2));
+    fclose(file);
+    assert(ir_bin_open(fname) == NULL);
+    ir_list_free(&prog->instrs);
+    ir_fun_free(prog);
+
+    // well framed, but no function the compiler would make
+    for (u32 i = 0; i < 3; i++) {
+        ir_list list = {0};
+        oprd_t  x = var_alloc("x", 1), y = var_alloc(NULL, 1);
+        IR_t   *label = ir_alloc(IR_LABEL), *read = ir_alloc(IR_READ, x);
+        ir_append(&list, label);
+        ir_append(&list, read);
+        switch (i) {
+            case 0: ir_append(&list, ir_alloc(IR_BRANCH, OP_ADD, x, y, label)); break;
+            case 1: ir_append(&list, ir_alloc(IR_BINARY, OP_NE + 1, y, x, x)); break;
+            case 2: ir_append(&list, ir_alloc(IR_GOTO, read)); break;
+        }
+        ir_append(&list, ir_alloc(IR_RETURN, x));
+        prog = fun_alloc("bad", list);
+        file = fopen(fname, "w");
+        ir_bin_write(file, prog);
+        fclose(file);
+        ir_bin_t *bin = ir_bin_open(fname);
+        assert(bin != NULL);
+        assert(ir_bin_fun(bin, 0) == NULL);
+        ir_bin_close(bin);
+        ir_list_free(&prog->instrs);
+        ir_fun_free(prog);
+    }
+    unlink(fname);
+}
+
+i32 main(void) {
+    test_roundtrip();
+    test_malformed();
+    puts("PASSED");
+}
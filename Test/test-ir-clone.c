@@ -0,0 +1,134 @@
+#include "common.h"
+#include "ir.h"
+
+// `a + 1 < 5 || a == a + 1` as `cond_gen` leaves it, both ways out pending
+static ir_list build_cond(oprd_t a) {
+    ir_list list = {0};
+    oprd_t  t    = var_alloc(NULL, 1);
+    IR_t   *tru0 = ir_alloc(IR_BRANCH, OP_LT, t, lit_alloc(5), NULL);
+    IR_t   *fls  = ir_alloc(IR_LABEL);
+    IR_t   *tru1 = ir_alloc(IR_BRANCH, OP_EQ, a, t, NULL);
+    IR_t   *fls1 = ir_alloc(IR_GOTO, NULL);
+    ir_append(&list, ir_alloc(IR_BINARY, OP_ADD, t, a, lit_alloc(1)));
+    ir_append(&list, tru0);
+    ir_append(&list, ir_alloc(IR_GOTO, fls));
+    ir_append(&list, fls);
+    ir_append(&list, tru1);
+    ir_append(&list, fls1);
+    chain_insert(&list.tru, tru0);
+    chain_insert(&list.tru, tru1);
+    chain_insert(&list.fls, fls1);
+    return list;
+}
+
+// `build_cond` twice, the second time generated again or cloned
+static ir_list build_twice(bool clone) {
+    ir_reset_ids();
+    oprd_t  a     = var_alloc("a", 1);
+    ir_list first = build_cond(a);
+    ir_list again = clone ? ir_clone(&first) : build_cond(a);
+    IR_t   *tru = ir_alloc(IR_LABEL), *fls = ir_alloc(IR_LABEL);
+    chain_resolve(&first.tru, tru);
+    chain_resolve(&first.fls, fls);
+    chain_resolve(&again.tru, tru);
+    chain_resolve(&again.fls, fls);
+    ir_concat(&first, again);
+    ir_append(&first, tru);
+    ir_append(&first, fls);
+    return first;
+}
+
+static bool same_oprd(oprd_t x, oprd_t y) {
+    return x.kind == y.kind && x.val == y.val;
+}
+
+static void test_clone() {
+    ir_list want = build_twice(false), got = build_twice(true);
+    assert(want.size == got.size);
+    for (IR_t *l = want.head, *r = got.head; l; l = l->next, r = r->next) {
+        assert(l->id == r->id && l->kind == r->kind && l->op == r->op);
+        assert(same_oprd(l->tar, r->tar) && same_oprd(l->lhs, r->lhs) && same_oprd(l->rhs, r->rhs));
+        assert((l->jmpto == NULL) == (r->jmpto == NULL));
+        assert(l->jmpto == NULL || l->jmpto->id == r->jmpto->id);
+    }
+    ir_check(&got);
+    ir_list_free(&want);
+    ir_list_free(&got);
+}
+
+// the copy in `clone` of the `i`th instruction of the list cloned
+static IR_t *nth(ir_list *clone, u32 i) {
+    IR_t *it = clone->head;
+    while (i-- > 0) {
+        it = it->next;
+    }
+    return it;
+}
+
+// a list whose ids and temporaries are interleaved with another's, which
+// also reads a temporary defined before it
+static void test_interleaved() {
+    ir_reset_ids();
+    ir_list list = {0}, other = {0};
+    oprd_t  a = var_alloc("a", 1), live = var_alloc(NULL, 1);
+    oprd_t  t1 = var_alloc(NULL, 2), x = var_alloc(NULL, 2), t2 = var_alloc(NULL, 3);
+    IR_t   *label = ir_alloc(IR_LABEL), *outside = ir_alloc(IR_LABEL);
+    ir_append(&list, ir_alloc(IR_BINARY, OP_ADD, t1, a, live));
+    ir_append(&other, ir_alloc(IR_ASSIGN, x, a));
+    ir_append(&list, label);
+    ir_append(&other, outside);
+    ir_append(&list, ir_alloc(IR_BRANCH, OP_LT, t1, lit_alloc(5), label));
+    ir_append(&other, ir_alloc(IR_ASSIGN, x, live));
+    ir_append(&list, ir_alloc(IR_BINARY, OP_MUL, t2, t1, lit_alloc(2)));
+    ir_append(&list, ir_alloc(IR_GOTO, outside));
+    IR_t *pending = ir_alloc(IR_BRANCH, OP_EQ, t2, a, NULL);
+    ir_append(&list, pending);
+    chain_insert(&list.tru, pending);
+
+    IR_t *last = ir_alloc(IR_LABEL);
+    ir_append(&other, last);
+    oprd_t  before = var_alloc(NULL, 4);
+    ir_list clone  = ir_clone(&list);
+    oprd_t  after  = var_alloc(NULL, 4);
+    assert(clone.size == list.size);
+
+    // fresh ids, none given out twice
+    for (IR_t *l = list.head, *r = clone.head; l; l = l->next, r = r->next) {
+        assert(l->kind == r->kind && l->op == r->op);
+        assert(r->id > last->id);
+        for (IR_t *it = r->next; it; it = it->next) {
+            assert(it->id != r->id);
+        }
+    }
+    IR_t *add = nth(&clone, 0), *branch = nth(&clone, 2), *mul = nth(&clone, 3);
+    // temporaries defined in the list are renamed alike, and to none in use
+    oprd_t new1 = add->tar, new2 = mul->tar;
+    assert(new1.id != t1.id && new2.id != t2.id && new1.id != new2.id);
+    assert(new1.id > before.id && new2.id > before.id);
+    assert(after.id > new1.id && after.id > new2.id);
+    assert(branch->lhs.id == new1.id && mul->lhs.id == new1.id);
+    assert(nth(&clone, 5)->lhs.id == new2.id);
+    // what comes from outside it is not
+    assert(add->lhs.id == a.id && add->rhs.id == live.id);
+    assert(nth(&clone, 5)->rhs.id == a.id);
+
+    // jumps within the list go to the copies, others where they did
+    assert(branch->jmpto == nth(&clone, 1));
+    assert(nth(&clone, 4)->jmpto == outside);
+    assert(clone.tru.head->ir == nth(&clone, 5) && clone.fls.head == NULL);
+
+    IR_t *label2 = ir_alloc(IR_LABEL);
+    chain_resolve(&list.tru, label2);
+    chain_resolve(&clone.tru, label2);
+    ir_check(&clone);
+    ir_concat(&list, other);
+    ir_concat(&list, clone);
+    ir_append(&list, label2);
+    ir_list_free(&list);
+}
+
+i32 main(void) {
+    test_clone();
+    test_interleaved();
+    puts("PASSED");
+}
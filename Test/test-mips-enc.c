@@ -0,0 +1,130 @@
+#include "common.h"
+#include "mips-asm.h"
+#include "mips-enc.h"
+#include <elf.h>
+#include <string.h>
+
+static mips_prog *assemble(const char *src) {
+    FILE *file = tmpfile();
+    fputs(src, file);
+    rewind(file);
+    mips_prog *prog = mips_asm_parse(file);
+    fclose(file);
+    return prog;
+}
+
+static const char *SRC =
+    ".data\n"
+    "_msg: .asciiz \"hi\"\n"
+    "_arr: .space 8\n"
+    ".text\n"
+    "main:\n"
+    "  addi $sp, $sp, -4\n"
+    "  li $t0, 70000\n"
+    "  li $t1, 40000\n"
+    "  andi $t1, $t0, 131071\n"
+    "  la $a0, _arr\n"
+    "loop:\n"
+    "  blt $t0, $t1, loop\n"
+    "  bge $t0, $t1, done\n"
+    "  div $t2, $t0, $t1\n"
+    "  mul $t2, $t2, $t0\n"
+    "  sll $t3, $t2, 2\n"
+    "  move $v0, $t3\n"
+    "  sw $v0, -8($fp)\n"
+    "  beqz $v0, done\n"
+    "  jal main\n"
+    "done:\n"
+    "  jr $ra\n"
+    "  syscall\n";
+
+// what the decoder makes of each word of SRC, laid out at MTEXT_BASE
+static const char *LISTING[] = {
+    "addi $sp, $sp, -4",
+    "lui $at, 0x1",
+    "ori $t0, $at, 0x1170",
+    "ori $t1, $zero, 0x9c40",
+    "lui $at, 0x1",
+    "ori $at, $at, 0xffff",
+    "and $t1, $t0, $at",
+    "lui $at, 0x1001",
+    "addiu $a0, $at, 3",
+    "slt $at, $t0, $t1",
+    "bne $at, $zero, 0x00400024",
+    "slt $at, $t0, $t1",
+    "beq $at, $zero, 0x00400054",
+    "div $t0, $t1",
+    "mflo $t2",
+    "mul $t2, $t2, $t0",
+    "sll $t3, $t2, 2",
+    "addu $v0, $t3, $zero",
+    "sw $v0, -8($fp)",
+    "beq $v0, $zero, 0x00400054",
+    "jal 0x00400000",
+    "jr $ra",
+    "syscall",
+};
+
+static void test_encode() {
+    mips_prog *prog = assemble(SRC);
+    assert(prog != NULL);
+    mcode_t *code = mips_encode(prog, MTEXT_BASE, MDATA_BASE);
+    assert(code != NULL);
+    assert(code->nword == ARR_LEN(LISTING));
+    char buf[64];
+    for (u32 i = 0; i < code->nword; i++) {
+        assert(mips_decode(code->words[i], MTEXT_BASE + 4 * i, buf, sizeof(buf)));
+        assert(!strcmp(buf, LISTING[i]));
+    }
+    assert(code->words[0] == 0x23bdfffc);
+    assert(code->words[21] == 0x03e00008);
+    assert(code->words[22] == 0x0000000c);
+    // la, and jal
+    assert(code->nreloc == 3);
+    assert(code->relocs[0].type == R_MIPS_HI16 && code->relocs[0].data && code->relocs[0].offset == 28);
+    assert(code->relocs[2].type == R_MIPS_26 && !code->relocs[2].data);
+    assert(!mips_decode(0xffffffff, 0, buf, sizeof(buf)));
+    mips_code_free(code);
+    mips_prog_free(prog);
+}
+
+static void test_elf() {
+    mips_prog *prog = assemble(SRC);
+    mcode_t   *code = mips_encode(prog, 0, 0);
+    assert(code->words[7] == 0x3c010000); // lui $at, %hi(_arr), left to the linker
+    FILE *file = tmpfile();
+    mips_write_elf(file, prog, code);
+    rewind(file);
+    Elf32_Ehdr ehdr;
+    assert(fread(&ehdr, sizeof(ehdr), 1, file) == 1);
+    assert(!memcmp(ehdr.e_ident, ELFMAG, SELFMAG));
+    assert(ehdr.e_ident[EI_CLASS] == ELFCLASS32 && ehdr.e_ident[EI_DATA] == ELFDATA2LSB);
+    assert(ehdr.e_type == ET_REL && ehdr.e_machine == EM_MIPS);
+
+    Elf32_Shdr shdrs[16];
+    assert(ehdr.e_shnum <= ARR_LEN(shdrs));
+    fseek(file, ehdr.e_shoff, SEEK_SET);
+    assert(fread(shdrs, sizeof(Elf32_Shdr), ehdr.e_shnum, file) == ehdr.e_shnum);
+    const Elf32_Shdr *text = &shdrs[1];
+    assert(text->sh_type == SHT_PROGBITS && text->sh_size == 4 * code->nword);
+    u32 word;
+    fseek(file, text->sh_offset, SEEK_SET);
+    assert(fread(&word, 4, 1, file) == 1 && word == code->words[0]);
+    fclose(file);
+    mips_code_free(code);
+    mips_prog_free(prog);
+}
+
+static void test_misfit() {
+    mips_prog *prog = assemble("main:\n  lw $t0, 40000($sp)\n");
+    assert(prog != NULL);
+    assert(mips_encode(prog, MTEXT_BASE, MDATA_BASE) == NULL);
+    mips_prog_free(prog);
+}
+
+i32 main(void) {
+    test_encode();
+    test_elf();
+    test_misfit();
+    puts("PASSED");
+}
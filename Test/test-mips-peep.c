@@ -0,0 +1,127 @@
+#include "common.h"
+#include "mips-peep.h"
+#include <string.h>
+
+static mline_t lines[32];
+static u32     nline;
+
+static mline_t *inst(minst_kind_t kind, regs_t rd, regs_t rs, regs_t rt, i32 imm) {
+    mline_t *ml = &lines[nline++];
+    *ml         = (mline_t){ML_INST, kind, rd, rs, rt, imm};
+    return ml;
+}
+
+// `kind rt, imm(rs)`, `kind rt, rs, imm` or `li rt, imm`
+static void ri(minst_kind_t kind, regs_t rt, regs_t rs, i32 imm) {
+    inst(kind, 0, rs, rt, imm);
+}
+
+static void rrr(minst_kind_t kind, regs_t rd, regs_t rs, regs_t rt) {
+    inst(kind, rd, rs, rt, 0);
+}
+
+static void jump(minst_kind_t kind, const char *label) {
+    strcpy(inst(kind, 0, 0, 0, 0)->label, label);
+}
+
+static void label(const char *str) {
+    mline_t *ml = &lines[nline++];
+    *ml         = (mline_t){.line = ML_LABEL};
+    strcpy(ml->label, str);
+}
+
+// runs the pass, leaves what is left at the front of `lines`
+static u32 peep() {
+    mips_peep(lines, nline);
+    u32 len = 0;
+    for (u32 i = 0; i < nline; i++) {
+        if (lines[i].line != ML_DEAD) {
+            lines[len++] = lines[i];
+        }
+    }
+    nline = 0;
+    return len;
+}
+
+static bool is(u32 i, minst_kind_t kind, regs_t reg, regs_t rs, i32 imm) {
+    const mline_t *ml = &lines[i];
+    return ml->line == ML_INST && ml->kind == kind && ml->rt == reg && ml->rs == rs && ml->imm == imm;
+}
+
+static void test_forward() {
+    // t = a + b; c = t
+    ri(MI_LW, $t0, $sp, 4);
+    ri(MI_LW, $t1, $sp, 8);
+    rrr(MI_ADD, $t2, $t0, $t1);
+    ri(MI_SW, $t2, $sp, 12);
+    ri(MI_LW, $t0, $sp, 12);
+    ri(MI_SW, $t0, $sp, 16);
+    assert(peep() == 5);
+    assert(is(3, MI_SW, $t2, $sp, 12));
+    assert(is(4, MI_SW, $t2, $sp, 16));
+
+    // a store through a pointer may hit the slot
+    ri(MI_SW, $t0, $sp, 8);
+    ri(MI_SW, $t1, $t2, 0);
+    ri(MI_LW, $t0, $sp, 8);
+    ri(MI_SW, $t0, $sp, 4);
+    assert(peep() == 4);
+    assert(is(2, MI_LW, $t0, $sp, 8));
+
+    // nor across a label
+    ri(MI_SW, $t0, $sp, 8);
+    label("L");
+    ri(MI_LW, $t1, $sp, 8);
+    ri(MI_SW, $t1, $sp, 4);
+    assert(peep() == 4);
+    assert(is(2, MI_LW, $t1, $sp, 8));
+}
+
+static void test_imm() {
+    ri(MI_LW, $t0, $sp, 4);
+    ri(MI_LI, $t1, $zero, 4);
+    rrr(MI_SUB, $t2, $t0, $t1);
+    ri(MI_SW, $t2, $sp, 8);
+    ri(MI_LI, $t0, $zero, 0);
+    ri(MI_SW, $t0, $sp, 12);
+    assert(peep() == 4);
+    assert(is(1, MI_ADDI, $t2, $t0, -4));
+    assert(is(3, MI_SW, $zero, $sp, 12));
+}
+
+static void test_sp() {
+    // write(a); write(b)
+    jump(MI_JAL, "write");
+    ri(MI_LW, $ra, $sp, 0);
+    ri(MI_ADDI, $sp, $sp, 4);
+    ri(MI_LW, $a0, $sp, 8);
+    ri(MI_ADDI, $sp, $sp, -4);
+    ri(MI_SW, $ra, $sp, 0);
+    jump(MI_JAL, "write");
+    assert(peep() == 4);
+    assert(is(1, MI_LW, $ra, $sp, 0));
+    assert(is(2, MI_LW, $a0, $sp, 12));
+    assert(lines[3].kind == MI_JAL);
+}
+
+static void test_branch() {
+    ri(MI_LW, $t0, $sp, 4);
+    ri(MI_LI, $t1, $zero, 1);
+    inst(MI_BEQ, 0, $t0, $t1, 0);
+    strcpy(lines[nline - 1].label, "L");
+    label("M");
+    label("L");
+    jump(MI_J, "L");
+    label("L2");
+    assert(peep() == 4);
+    assert(lines[0].line == ML_LABEL && lines[1].line == ML_LABEL);
+    assert(lines[2].kind == MI_J);
+}
+
+i32 main(void) {
+    test_forward();
+    test_imm();
+    test_sp();
+    test_branch();
+    puts("PASSED");
+}
@@ -0,0 +1,110 @@
+#include "common.h"
+#include "mips-asm.h"
+#include "mips-sim.h"
+#include <string.h>
+
+static mips_prog *assemble(const char *src) {
+    FILE *file = tmpfile();
+    fputs(src, file);
+    rewind(file);
+    mips_prog *prog = mips_asm_parse(file);
+    fclose(file);
+    return prog;
+}
+
+// runs `src` with `input`, leaves its output in `output`
+static bool run(const char *src, const char *input, char *output, sim_stat_t *stat) {
+    mips_prog *prog = assemble(src);
+    assert(prog != NULL);
+    FILE *in = tmpfile(), *out = tmpfile();
+    fputs(input, in);
+    rewind(in);
+    *stat   = (sim_stat_t){0};
+    bool ok = mips_sim(prog, in, out, 0, stat);
+    rewind(out);
+    u32 len     = fread(output, 1, 255, out);
+    output[len] = '\0';
+    fclose(in);
+    fclose(out);
+    mips_prog_free(prog);
+    return ok;
+}
+
+static void test_counts() {
+    static const char *src =
+        "main:\n"
+        "  li $t0, 6\n"
+        "  sw $t0, -4($sp)\n"
+        "  lw $t1, -4($sp)\n"
+        "  mul $t2, $t1, $t0 # load-use stall\n"
+        "  move $v0, $t2\n"
+        "  jr $ra\n";
+    char       output[256];
+    sim_stat_t stat;
+    assert(run(src, "", output, &stat));
+    assert(stat.instrs == 6);
+    assert(stat.loads == 1 && stat.stores == 1);
+    assert(stat.cycles == 6 + 1 + (SIM_MUL_CYCLES - 1) + 1);
+}
+
+static void test_fact() {
+    static const char *src =
+        ".data\n"
+        "_ret: .asciiz \"\\n\"\n"
+        ".text\n"
+        "main:\n"
+        "  addi $sp, $sp, -4\n"
+        "  sw $ra, 0($sp)\n"
+        "  li $v0, 5\n"
+        "  syscall\n"
+        "  move $a0, $v0\n"
+        "  jal fact\n"
+        "  move $a0, $v0\n"
+        "  li $v0, 1\n"
+        "  syscall\n"
+        "  li $v0, 4\n"
+        "  la $a0, _ret\n"
+        "  syscall\n"
+        "  lw $ra, 0($sp)\n"
+        "  addi $sp, $sp, 4\n"
+        "  jr $ra\n"
+        "fact:\n"
+        "  li $v0, 1\n"
+        "  ble $a0, $0, fact_ret\n"
+        "  addi $sp, $sp, -8\n"
+        "  sw $ra, 0($sp)\n"
+        "  sw $a0, 4($sp)\n"
+        "  addi $a0, $a0, -1\n"
+        "  jal fact\n"
+        "  lw $a0, 4($sp)\n"
+        "  lw $ra, 0($sp)\n"
+        "  addi $sp, $sp, 8\n"
+        "  mul $v0, $v0, $a0\n"
+        "fact_ret:\n"
+        "  jr $ra\n";
+    char       output[256];
+    sim_stat_t stat;
+    assert(run(src, "10", output, &stat));
+    assert(!strcmp(output, "3628800\n"));
+    assert(stat.calls == 11);
+    assert(stat.branches == 11 && stat.taken == 1);
+    assert(stat.syscalls == 3);
+}
+
+static void test_fault() {
+    char       output[256];
+    sim_stat_t stat;
+    assert(!run("main:\n  li $t0, 0\n  div $t1, $t0, $t0\n", "", output, &stat));
+    assert(!run("main:\n  lw $t0, 0($0)\n", "", output, &stat));
+    assert(!run("main:\n  li $v0, 5\n  syscall\n", "", output, &stat));
+    assert(assemble("main:\n  frob $t0\n") == NULL);
+    assert(assemble("main:\n  j nowhere\n") == NULL);
+    assert(assemble("foo:\n  jr $ra\n") == NULL);
+}
+
+i32 main(void) {
+    test_counts();
+    test_fact();
+    test_fault();
+    puts("PASSED");
+}